@@ -1,63 +1,97 @@
 #include "app.h"
 #include "res.h"
+#ifdef _WIN32
+#include "d3d12backend.h"
+#else
+#include "nullbackend.h"
+#endif
 
 void App::logVidMemUsage()
 {
-    DXGI_QUERY_VIDEO_MEMORY_INFO vidMemInfo;
-    if (SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &vidMemInfo))) {
-        log("Video memory local: Budget %llu KB CurrentUsage %llu KB AvailableForReservation %llu KB CurrentReservation %llu KB",
-            vidMemInfo.Budget / 1024, vidMemInfo.CurrentUsage / 1024,
-            vidMemInfo.AvailableForReservation / 1024, vidMemInfo.CurrentReservation / 1024);
-    }
-    if (SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &vidMemInfo))) {
-        log("Video memory non-local: Budget %llu KB CurrentUsage %llu KB AvailableForReservation %llu KB CurrentReservation %llu KB",
-            vidMemInfo.Budget / 1024, vidMemInfo.CurrentUsage / 1024,
-            vidMemInfo.AvailableForReservation / 1024, vidMemInfo.CurrentReservation / 1024);
-    }
+    m_backend->logMemoryUsage();
+    if (m_resHeapAllocator.isInitialized())
+        m_resHeapAllocator.logStats();
+    if (m_bufferPool.isInitialized())
+        m_bufferPool.logStats();
+}
+
+// an interval of 0 means never, and must not end up as a modulo by zero
+static bool shouldLogDescHeapStats(UINT64 frame)
+{
+    if (!DESC_HEAP_STATS_LOG_INTERVAL)
+        return false;
+    return frame % (std::max)(UINT64(1), UINT64(DESC_HEAP_STATS_LOG_INTERVAL)) == 0;
 }
 
 void App::bumpFrameFence()
 {
     m_lastFrameFenceValue += 1;
     m_frameFenceValues[m_currentFrameSlot] = m_lastFrameFenceValue;
-    m_cmdQueue->Signal(m_frameFence, m_frameFenceValues[m_currentFrameSlot]);
+    m_backend->signalFence(m_frameFenceValues[m_currentFrameSlot]);
 }
 
-void App::waitForFrameFence()
+void App::waitForFrameFence(UINT frameSlot)
 {
-    if (m_frameFence->GetCompletedValue() < m_frameFenceValues[m_currentFrameSlot]) {
-        m_frameFence->SetEventOnCompletion(m_frameFenceValues[m_currentFrameSlot], m_frameFenceEvent);
-        WaitForSingleObject(m_frameFenceEvent, INFINITE);
+    Trace::Scope traceScope("App::waitForFrameFence");
+    m_backend->waitFence(m_frameFenceValues[frameSlot]);
+}
+
+void App::submitCopyBatch(size_t count)
+{
+    {
+        Trace::Scope traceScope("ExecuteCopyCommandLists");
+        m_backend->executeCopyCommandLists(UINT(count), m_copyListBatch.data());
     }
+    m_lastCopyFenceValue += 1;
+    m_copyFrameFenceValues[m_currentFrameSlot] = m_lastCopyFenceValue;
+    m_backend->signalCopyFence(m_lastCopyFenceValue);
+}
+
+void App::queueWaitForCopies()
+{
+    // uploads that are known to be done, or already waited for, need no wait
+    if (m_lastCopyFenceValue <= m_copyWaitedValue || m_lastCopyFenceValue <= m_backend->completedCopyFenceValue())
+        return;
+
+    m_backend->queueWaitCopyFence(m_lastCopyFenceValue);
+    m_copyWaitedValue = m_lastCopyFenceValue;
 }
 
 void App::waitGpu()
 {
-    if (!m_cmdQueue)
+    if (!m_backend->isInitialized())
         return;
 
     bumpFrameFence();
-    waitForFrameFence();
+    waitForFrameFence(m_currentFrameSlot);
+    m_backend->waitCopyFence(m_lastCopyFenceValue);
+    m_descHeapMgr.reclaimDeferred(m_lastFrameFenceValue);
+    m_bindless.reclaim(m_lastFrameFenceValue);
+    m_bufferPool.reclaim(m_lastFrameFenceValue);
+    m_readbackRing.dispatchCompleted(m_lastFrameFenceValue);
+    m_readbackRing.waitIdle();
 }
 
 bool App::createSwapchainViews()
 {
-    D3D12_CPU_DESCRIPTOR_HANDLE firstRtv = m_descHeapMgr.allocate(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, SWAPCHAIN_BUFFER_COUNT);
-    const UINT rtvStride = m_descHeapMgr.handleSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    DescHeapMgr::ViewDesc views[SWAPCHAIN_BUFFER_COUNT] = {};
     for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; ++i) {
-        HRESULT hr = m_swapchain->GetBuffer(i, IID_ID3D12Resource, reinterpret_cast<void **>(&m_rt[i]));
-        if (FAILED(hr)) {
-            logHr("Failed to get swapchain buffer", hr);
+        if (!m_backend->getBackBuffer(i, &m_rt[i]))
             return false;
-        }
-        m_rtv[i].ptr = firstRtv.ptr + SIZE_T(i) * rtvStride;
-        m_device->CreateRenderTargetView(m_rt[i], nullptr, m_rtv[i]);
+        views[i].type = DescHeapMgr::ViewDesc::RenderTarget;
+        views[i].resource = m_rt[i];
     }
+    const D3D12_CPU_DESCRIPTOR_HANDLE firstRtv = m_descHeapMgr.createViews(views, SWAPCHAIN_BUFFER_COUNT);
+    const UINT rtvStride = m_descHeapMgr.handleSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; ++i)
+        m_rtv[i].ptr = firstRtv.ptr + SIZE_T(i) * rtvStride;
 
     m_dsv = m_descHeapMgr.allocate(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 1);
-    m_ds = Res::createDepthStencil(m_device, m_dsv, m_width, m_height, 1);
-    if (!m_ds)
-        return false;
+    if (m_device) {
+        m_ds = Res::createDepthStencil(m_device, m_dsv, m_width, m_height, 1, &m_resHeapAllocator);
+        if (!m_ds)
+            return false;
+    }
 
     return true;
 }
@@ -65,159 +99,82 @@ bool App::createSwapchainViews()
 void App::releaseSwapchainViews()
 {
     if (m_ds) {
-        m_ds->Release();
+        Res::releaseResource(m_ds, &m_resHeapAllocator);
         m_ds = nullptr;
     }
     if (m_dsv.ptr) {
         m_descHeapMgr.release(m_dsv, 1);
         m_dsv.ptr = 0;
     }
+    // the views are one range, see createSwapchainViews()
+    if (m_rtv[0].ptr)
+        m_descHeapMgr.release(m_rtv[0], SWAPCHAIN_BUFFER_COUNT);
     for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; ++i) {
         if (m_rt[i]) {
             m_rt[i]->Release();
             m_rt[i] = nullptr;
         }
-        if (m_rtv[i].ptr) {
-            m_descHeapMgr.release(m_rtv[i], 1);
-            m_rtv[i].ptr = 0;
-        }
+        m_rtv[i].ptr = 0;
     }
 }
 
 bool App::initialize()
 {
+    static const char *threadModelNames[] = { "thread per builder", "job system", "none" };
     log("App::initialize() Threaded command list building: %s Forced adapter index: %d Sync interval: %d Debug layer: %s",
-        m_threadModel == Builder::ThreadModel::Threaded ? "yes" : "no",
+        threadModelNames[int(m_threadModel)],
         ADAPTER_INDEX, PRESENT_SYNC_INTERVAL, ENABLE_DEBUG_LAYER ? "yes" : "no");
 
-    HRESULT hr = CreateDXGIFactory2(0, IID_IDXGIFactory2, reinterpret_cast<void **>(&m_dxgiFactory));
-    if (FAILED(hr)) {
-        logHr("Failed to create DXGI factory", hr);
-        return false;
-    }
-
-    IDXGIAdapter1 *adapterToUse = nullptr;
-    IDXGIAdapter1 *adapter;
-
-    for (int adapterIndex = 0; m_dxgiFactory->EnumAdapters1(UINT(adapterIndex), &adapter) != DXGI_ERROR_NOT_FOUND; ++adapterIndex) {
-        DXGI_ADAPTER_DESC1 desc;
-        adapter->GetDesc1(&desc);
-        log("Adapter %d: '%ls' (vendor 0x%X device 0x%X flags 0x%X)",
-            adapterIndex, desc.Description, desc.VendorId, desc.DeviceId, desc.Flags);
-        if (!adapterToUse && (ADAPTER_INDEX < 0 || ADAPTER_INDEX == adapterIndex)) {
-            adapterToUse = adapter;
-            log("  using this adapter");
-        } else {
-            adapter->Release();
-        }
-    }
-    if (!adapterToUse) {
-        log("No adapter");
-        return false;
-    }
-
-    if (FAILED(adapterToUse->QueryInterface(IID_IDXGIAdapter3, reinterpret_cast<void **>(&m_adapter)))) {
-        log("IDXGIAdapter3 not supported");
-        adapterToUse->Release();
+    if (!m_backend->initialize(m_hWnd, m_width, m_height))
         return false;
-    }
 
-    if (ENABLE_DEBUG_LAYER) {
-        ID3D12Debug *debugController;
-        if (SUCCEEDED(D3D12GetDebugInterface(IID_ID3D12Debug, reinterpret_cast<void **>(&debugController)))) {
-            debugController->EnableDebugLayer();
-            log("D3D12 debug layer enabled");
-            debugController->Release();
-        }
-    }
+    m_device = m_backend->device();
+    m_backend->queryFeatures(&m_features, &m_archFeatures);
+    if (m_device && RESOURCE_HEAP_SIZE)
+        m_resHeapAllocator.initialize(m_device, m_features.ResourceHeapTier, RESOURCE_HEAP_SIZE);
 
-    hr = D3D12CreateDevice(adapterToUse, FEATURE_LEVEL, IID_ID3D12Device, reinterpret_cast<void **>(&m_device));
-    adapterToUse->Release();
-    if (FAILED(hr)) {
-        logHr("Failed to create D3D12 device", hr);
-        return false;
-    }
+    m_currentFrameSlot = m_backend->currentBackBufferIndex();
+    m_buildFrameSlot = m_currentFrameSlot;
 
-    hr = m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &m_features, sizeof(m_features));
-    if (FAILED(hr)) {
-        logHr("Failed to query device options", hr);
-        return false;
-    }
-    hr = m_device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &m_archFeatures, sizeof(m_archFeatures));
-    if (FAILED(hr)) {
-        logHr("Failed to query arch features", hr);
-        return false;
-    }
-    log("Resource binding tier: %d Resource heap tier: %d Tile-based: %d UMA: %d CacheCoherentUMA: %d",
-        m_features.ResourceBindingTier, m_features.ResourceHeapTier,
-        m_archFeatures.TileBasedRenderer, m_archFeatures.UMA, m_archFeatures.CacheCoherentUMA);
-
-    logVidMemUsage();
-
-    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
-    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-    if (FAILED(m_device->CreateCommandQueue(&queueDesc, IID_ID3D12CommandQueue, reinterpret_cast<void **>(&m_cmdQueue)))) {
-        logHr("Failed to create command queue", hr);
-        return false;
+    for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; ++i) {
+        m_frameFenceValues[i] = 0;
+        m_copyFrameFenceValues[i] = 0;
     }
+    // a new copy fence starts from zero, unlike the frame fence nothing is signaled on it before waiting
+    m_lastCopyFenceValue = 0;
+    m_copyWaitedValue = 0;
 
-    IDXGISwapChain1 *swapchain1;
-    DXGI_SWAP_CHAIN_DESC1 desc = {};
-    desc.Width = m_width;
-    desc.Height = m_height;
-    desc.Format = SWAPCHAIN_FORMAT;
-    desc.SampleDesc.Count = 1;
-    desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    desc.BufferCount = SWAPCHAIN_BUFFER_COUNT;
-    desc.Scaling = DXGI_SCALING_STRETCH;
-    desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    hr = m_dxgiFactory->CreateSwapChainForHwnd(m_cmdQueue, m_hWnd, &desc, nullptr, nullptr, &swapchain1);
-    if (FAILED(hr)) {
-        logHr("Failed to create swapchain", hr);
+    m_descHeapMgr.initialize(m_backend);
+    if (m_device && !m_uploadRing.initialize(m_device, UPLOAD_RING_SIZE))
         return false;
-    }
-
-    hr = swapchain1->QueryInterface(IID_IDXGISwapChain3, reinterpret_cast<void **>(&m_swapchain));
-    swapchain1->Release();
-    if (FAILED(hr)) {
-        logHr("IDXGISwapChain3 not supported", hr);
+    if (m_device)
+        m_bufferPool.initialize(m_device, &m_resHeapAllocator);
+    if (m_device && READBACK_RING_SIZE && !m_readbackRing.initialize(m_device, READBACK_RING_SIZE, &m_jobSystem))
         return false;
+    UINT bindlessSize = BINDLESS_TABLE_SIZE;
+    if (bindlessSize && m_features.ResourceBindingTier < D3D12_RESOURCE_BINDING_TIER_2) {
+        log("Bindless descriptor table needs resource binding tier 2");
+        bindlessSize = 0;
     }
-
-    m_currentFrameSlot = m_swapchain->GetCurrentBackBufferIndex();
-
-    hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_ID3D12Fence, reinterpret_cast<void **>(&m_frameFence));
-    if (FAILED(hr)) {
-        logHr("Failed to create fence", hr);
+    if (!m_descRing.initialize(m_backend, DESCRIPTOR_RING_SIZE, bindlessSize))
         return false;
-    }
-    m_frameFenceEvent = CreateEvent(nullptr, false, false, nullptr);
-    for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; ++i)
-        m_frameFenceValues[i] = 0;
-
-    m_dxgiFactory->MakeWindowAssociation(m_hWnd, DXGI_MWA_NO_ALT_ENTER);
-
-    m_descHeapMgr.initialize(m_device);
+    if (bindlessSize)
+        m_bindless.initialize(&m_descRing);
 
     createSwapchainViews();
 
     for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
-        hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_ID3D12CommandAllocator,
-            reinterpret_cast<void **>(&m_cmdAllocator[i]));
-        if (FAILED(hr)) {
-            logHr("Failed to create command allocator", hr);
+        m_cmdAllocator[i] = m_backend->createCommandAllocator();
+        if (!m_cmdAllocator[i])
             return false;
-        }
     }
 
-    for (int i = 0; i < 2; ++i) {
-        hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_cmdAllocator[0], nullptr, IID_ID3D12GraphicsCommandList,
-            reinterpret_cast<void **>(&m_mainThreadDrawCmdList[i]));
-        if (FAILED(hr)) {
-            logHr("Failed to create graphics command list", hr);
-            return false;
+    for (int slot = 0; slot < FRAMES_IN_FLIGHT; ++slot) {
+        for (int i = 0; i < 2; ++i) {
+            m_mainThreadDrawCmdList[slot][i] = m_backend->createCommandList(m_cmdAllocator[slot]);
+            if (!m_mainThreadDrawCmdList[slot][i])
+                return false;
         }
-        m_mainThreadDrawCmdList[i]->Close();
     }
 
     return true;
@@ -225,6 +182,7 @@ bool App::initialize()
 
 void App::releaseResources()
 {
+    drainPipeline();
     waitGpu();
 
     for (ReleaseResourcesFunc f : m_releaseResourcesFuncs)
@@ -232,58 +190,34 @@ void App::releaseResources()
 
     postToAllBuildersAndWait(Builder::Event::ReleaseResources);
 
-    for (int i = 0; i < 2; ++i) {
-        if (m_mainThreadDrawCmdList[i]) {
-            m_mainThreadDrawCmdList[i]->Release();
-            m_mainThreadDrawCmdList[i] = nullptr;
+    for (int slot = 0; slot < FRAMES_IN_FLIGHT; ++slot) {
+        for (int i = 0; i < 2; ++i) {
+            if (m_mainThreadDrawCmdList[slot][i]) {
+                m_backend->releaseCommandList(m_mainThreadDrawCmdList[slot][i]);
+                m_mainThreadDrawCmdList[slot][i] = nullptr;
+            }
         }
     }
 
     for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
         if (m_cmdAllocator[i]) {
-            m_cmdAllocator[i]->Release();
+            m_backend->releaseCommandAllocator(m_cmdAllocator[i]);
             m_cmdAllocator[i] = nullptr;
         }
     }
 
     releaseSwapchainViews();
 
+    m_descRing.releaseResources();
+    m_bindless.releaseResources();
     m_descHeapMgr.releaseResources();
+    m_bufferPool.releaseResources();
+    m_uploadRing.releaseResources();
+    m_readbackRing.releaseResources();
+    m_resHeapAllocator.releaseResources();
 
-    if (m_frameFence) {
-        m_frameFence->Release();
-        m_frameFence = nullptr;
-    }
-
-    if (m_frameFenceEvent) {
-        CloseHandle(m_frameFenceEvent);
-        m_frameFenceEvent = nullptr;
-    }
-
-    if (m_swapchain) {
-        m_swapchain->Release();
-        m_swapchain = nullptr;
-    }
-
-    if (m_cmdQueue) {
-        m_cmdQueue->Release();
-        m_cmdQueue = nullptr;
-    }
-
-    if (m_device) {
-        m_device->Release();
-        m_device = nullptr;
-    }
-
-    if (m_adapter) {
-        m_adapter->Release();
-        m_adapter = nullptr;
-    }
-
-    if (m_dxgiFactory) {
-        m_dxgiFactory->Release();
-        m_dxgiFactory = nullptr;
-    }
+    m_device = nullptr;
+    m_backend->releaseResources();
 }
 
 void App::resize(UINT newWidth, UINT newHeight)
@@ -291,6 +225,8 @@ void App::resize(UINT newWidth, UINT newHeight)
     if (m_width == newWidth && m_height == newHeight)
         return;
 
+    Trace::Scope traceScope("App::resize");
+
     m_width = newWidth;
     m_height = newHeight;
     m_zeroSize = m_width < 1 || m_height < 1; // f.ex. when minimized
@@ -299,10 +235,14 @@ void App::resize(UINT newWidth, UINT newHeight)
 
     log("resize %ux%u", m_width, m_height);
 
-    if (m_swapchain) {
+    if (m_backend->isInitialized()) {
+        drainPipeline();
         waitGpu();
+        // recorded lists may refer to the old views
+        for (Builder *b : m_builders)
+            b->markDirty();
         releaseSwapchainViews();
-        HRESULT hr = m_swapchain->ResizeBuffers(SWAPCHAIN_BUFFER_COUNT, m_width, m_height, SWAPCHAIN_FORMAT, 0);
+        HRESULT hr = m_backend->resizeSwapchain(m_width, m_height);
         if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) {
             handleLostDevice();
             return;
@@ -310,77 +250,147 @@ void App::resize(UINT newWidth, UINT newHeight)
             logHr("Failed to resize swapchain buffer", hr);
         }
         createSwapchainViews();
-        m_currentFrameSlot = m_swapchain->GetCurrentBackBufferIndex();
+        m_currentFrameSlot = m_backend->currentBackBufferIndex();
+        m_buildFrameSlot = m_currentFrameSlot;
     }
 }
 
 void App::handleLostDevice()
 {
+    Trace::Scope traceScope("App::handleLostDevice");
     releaseResources();
     requestUpdate();
 }
 
 void App::beginFrame()
 {
-    waitForFrameFence();
-
-    m_cmdAllocator[m_currentFrameSlot]->Reset();
+    Trace::Scope traceScope("App::beginFrame");
+    waitForFrameFence(m_buildFrameSlot);
+    // the copy lists of the slot, and the upload ring space they read, are not
+    // covered by the frame fence unless something consumed them
+    m_backend->waitCopyFence(m_copyFrameFenceValues[m_buildFrameSlot]);
+    m_descRing.beginFrame(m_buildFrameSlot);
+    m_uploadRing.beginFrame(m_buildFrameSlot);
+    const UINT64 completedFenceValue = m_backend->completedFenceValue();
+    m_descHeapMgr.reclaimDeferred(completedFenceValue);
+    m_bindless.reclaim(completedFenceValue);
+    m_bufferPool.reclaim(completedFenceValue);
+    m_readbackRing.beginFrame(m_buildFrameSlot, pendingFrameFenceValue(), completedFenceValue);
+
+    m_backend->resetCommandAllocator(m_cmdAllocator[m_buildFrameSlot]);
 
     for (FrameExtraFunc f : m_preFrameFuncs)
         f();
 
-    m_mainThreadDrawCmdList[0]->Reset(m_cmdAllocator[m_currentFrameSlot], nullptr);
+    ID3D12GraphicsCommandList *cmdList = m_mainThreadDrawCmdList[m_buildFrameSlot][0];
+    m_backend->resetCommandList(cmdList, m_cmdAllocator[m_buildFrameSlot]);
     D3D12_RESOURCE_BARRIER rtBarrier = {};
     rtBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    rtBarrier.Transition.pResource = m_rt[m_currentFrameSlot];
+    rtBarrier.Transition.pResource = m_rt[m_buildFrameSlot];
     rtBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
     rtBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
     rtBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    m_mainThreadDrawCmdList[0]->ResourceBarrier(1, &rtBarrier);
-    m_mainThreadDrawCmdList[0]->Close();
+    m_backend->resourceBarrier(cmdList, rtBarrier);
+    m_backend->closeCommandList(cmdList);
 }
 
-void App::endFrame(const BuilderTable *bldTab)
+void App::prepareSubmit(const BuilderTable *bldTab)
 {
-    m_mainThreadDrawCmdList[1]->Reset(m_cmdAllocator[m_currentFrameSlot], nullptr);
+    ID3D12GraphicsCommandList *cmdList = m_mainThreadDrawCmdList[m_currentFrameSlot][1];
+    m_backend->resetCommandList(cmdList, m_cmdAllocator[m_currentFrameSlot]);
     D3D12_RESOURCE_BARRIER rtBarrier = {};
     rtBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
     rtBarrier.Transition.pResource = m_rt[m_currentFrameSlot];
     rtBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
     rtBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
     rtBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    m_mainThreadDrawCmdList[1]->ResourceBarrier(1, &rtBarrier);
-    m_mainThreadDrawCmdList[1]->Close();
+    m_backend->resourceBarrier(cmdList, rtBarrier);
+    m_backend->closeCommandList(cmdList);
 
+    // builders before m_submitPos have already gone out with an early submit
     size_t bldTotal = 0;
+    size_t copyTotal = 0;
     if (bldTab) {
-        for (const BuilderList &bldList : *bldTab) {
-            for (Builder *b : bldList) {
-                if (b->commandList())
-                    ++bldTotal;
+        for (size_t stage = m_submitPos.stage; stage < bldTab->size(); ++stage) {
+            const BuilderList &bldList((*bldTab)[stage]);
+            for (size_t i = stage == m_submitPos.stage ? m_submitPos.index : 0; i < bldList.size(); ++i) {
+                if (bldList[i]->commandList(m_currentFrameSlot)) {
+                    if (bldList[i]->type() == Builder::Type::CopyCommandList)
+                        ++copyTotal;
+                    else
+                        ++bldTotal;
+                }
             }
         }
     }
-    const size_t cmdListCount = 2 + bldTotal;
-    if (m_cmdListBatch.size() < cmdListCount)
-        m_cmdListBatch.resize(cmdListCount);
+    m_cmdListBatchCount = (m_frameBeginSubmitted ? 1 : 2) + bldTotal;
+    if (m_cmdListBatch.size() < m_cmdListBatchCount)
+        m_cmdListBatch.resize(m_cmdListBatchCount);
+    m_copyListBatchCount = copyTotal;
+    if (m_copyListBatch.size() < m_copyListBatchCount)
+        m_copyListBatch.resize(m_copyListBatchCount);
+    m_copyWaitPos = m_cmdListBatchCount;
 
     size_t batchPos = 0;
-    m_cmdListBatch[batchPos++] = m_mainThreadDrawCmdList[0];
+    size_t copyPos = 0;
+    if (!m_frameBeginSubmitted)
+        m_cmdListBatch[batchPos++] = m_mainThreadDrawCmdList[m_currentFrameSlot][0];
     if (bldTab) {
-        for (const BuilderList &bldList : *bldTab) {
-            for (Builder *b : bldList) {
-                ID3D12CommandList *cmdList = b->commandList();
-                if (cmdList)
+        for (size_t stage = m_submitPos.stage; stage < bldTab->size(); ++stage) {
+            const BuilderList &bldList((*bldTab)[stage]);
+            for (size_t i = stage == m_submitPos.stage ? m_submitPos.index : 0; i < bldList.size(); ++i) {
+                const Builder *b = bldList[i];
+                ID3D12CommandList *cmdList = b->commandList(m_currentFrameSlot);
+                if (!cmdList)
+                    continue;
+                if (b->type() == Builder::Type::CopyCommandList) {
+                    m_copyListBatch[copyPos++] = cmdList;
+                } else {
+                    // one wait covers all the copies of the frame, so only the first consumer needs it
+                    if (m_copyWaitPos == m_cmdListBatchCount && b->hasCopyDependency())
+                        m_copyWaitPos = batchPos;
                     m_cmdListBatch[batchPos++] = cmdList;
+                }
             }
         }
     }
-    m_cmdListBatch[batchPos++] = m_mainThreadDrawCmdList[1];
+    m_cmdListBatch[batchPos++] = m_mainThreadDrawCmdList[m_currentFrameSlot][1];
+
+    m_frameBeginSubmitted = false;
+    m_submitPos = {};
+}
 
-    m_cmdQueue->ExecuteCommandLists(cmdListCount, m_cmdListBatch.data());
+void App::submitFrame()
+{
+    executeFrame();
+    presentFrame();
+}
 
-    HRESULT hr = m_swapchain->Present(PRESENT_SYNC_INTERVAL, 0);
+void App::executeFrame()
+{
+    if (m_copyListBatchCount)
+        submitCopyBatch(m_copyListBatchCount);
+
+    {
+        Trace::Scope traceScope("ExecuteCommandLists");
+        if (m_copyWaitPos < m_cmdListBatchCount) {
+            if (m_copyWaitPos)
+                m_backend->executeCommandLists(UINT(m_copyWaitPos), m_cmdListBatch.data());
+            queueWaitForCopies();
+            m_backend->executeCommandLists(UINT(m_cmdListBatchCount - m_copyWaitPos), m_cmdListBatch.data() + m_copyWaitPos);
+        } else {
+            m_backend->executeCommandLists(UINT(m_cmdListBatchCount), m_cmdListBatch.data());
+        }
+    }
+}
+
+void App::presentFrame()
+{
+    HRESULT hr;
+    {
+        Trace::Scope traceScope("Present");
+        hr = m_backend->present(PRESENT_SYNC_INTERVAL);
+    }
     if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) {
         handleLostDevice();
         return;
@@ -390,12 +400,24 @@ void App::endFrame(const BuilderTable *bldTab)
     }
 
     bumpFrameFence();
-    m_currentFrameSlot = m_swapchain->GetCurrentBackBufferIndex();
+    if (shouldLogDescHeapStats(m_lastFrameFenceValue))
+        m_descHeapMgr.logStats();
+    m_currentFrameSlot = m_backend->currentBackBufferIndex();
+    if (!m_pipelined)
+        m_buildFrameSlot = m_currentFrameSlot;
+    else if (m_buildFrameSlot != m_currentFrameSlot)
+        log("Pipelined frame was built for slot %u but the next back buffer is %u", m_buildFrameSlot, m_currentFrameSlot);
 
     for (FrameExtraFunc f : m_postFrameFuncs)
         f();
 }
 
+void App::endFrame(const BuilderTable *bldTab)
+{
+    prepareSubmit(bldTab);
+    submitFrame();
+}
+
 void App::render()
 {
     m_needsRender = false;
@@ -404,41 +426,240 @@ void App::render()
 
     //log("render (elapsed since last: %lld ms)", m_renderTimestamp.restart());
 
-    if (!m_device) {
+    if (!m_backend->isInitialized()) {
         if (!initialize()) {
             releaseResources();
             return;
         }
     }
 
+    if (m_pipelined) {
+        renderPipelined();
+        return;
+    }
+
     beginFrame();
     const BuilderTable *bldTab = nullptr;
     if (m_frameFunc) {
         bldTab = m_frameFunc();
-        if (bldTab)
-            postToBuildersAndWait(Builder::Event::Build, *bldTab);
+        if (bldTab) {
+            Trace::Scope traceScope("App::buildFrame");
+            const Timestamp buildTime;
+            if (m_earlySubmit)
+                buildAndSubmitEarly(*bldTab);
+            else
+                postToBuildersAndWait(Builder::Event::Build, *bldTab);
+            if (ENABLE_BUILD_STATS)
+                m_fanInWait.record(buildTime.elapsedNs());
+        }
     }
     endFrame(bldTab);
 }
 
+void App::buildAndSubmitEarly(const BuilderTable &bldTab)
+{
+    // the frame-begin barriers go first, the rest follows in table order
+    // as soon as a contiguous run of builders is done, copy lists go out
+    // whenever they are done
+    ID3D12CommandList *beginCmdList = m_mainThreadDrawCmdList[m_currentFrameSlot][0];
+    {
+        Trace::Scope traceScope("ExecuteCommandLists");
+        m_backend->executeCommandLists(1, &beginCmdList);
+    }
+    m_frameBeginSubmitted = true;
+
+    m_pendingCopies.clear();
+    for (const BuilderList &bldList : bldTab) {
+        for (Builder *b : bldList) {
+            if (b->type() == Builder::Type::CopyCommandList)
+                m_pendingCopies.push_back(b);
+        }
+    }
+
+    m_buildGraph.setProgressEvent(&m_buildProgressEvent);
+
+    m_buildGraph.dispatch(Builder::Event::Build, bldTab, &m_buildLatch);
+    while (!submitFinishedBuilders(bldTab))
+        m_buildProgressEvent.wait();
+
+    // all completions have signaled once the latch is done
+    m_buildLatch.wait();
+    m_buildGraph.setProgressEvent(nullptr);
+}
+
+void App::submitFinishedCopies()
+{
+    // copies go out as soon as they are done, wherever they are in the table,
+    // so a queue wait issued for a consumer covers everything it depends on
+    size_t copyCount = 0;
+    size_t kept = 0;
+    for (Builder *b : m_pendingCopies) {
+        if (!m_buildGraph.isDone(b)) {
+            m_pendingCopies[kept++] = b;
+            continue;
+        }
+        if (ID3D12CommandList *cmdList = b->commandList(m_currentFrameSlot)) {
+            if (m_copyListBatch.size() <= copyCount)
+                m_copyListBatch.resize(copyCount + 1);
+            m_copyListBatch[copyCount++] = cmdList;
+        }
+    }
+    m_pendingCopies.resize(kept);
+    if (copyCount)
+        submitCopyBatch(copyCount);
+}
+
+bool App::submitFinishedBuilders(const BuilderTable &bldTab)
+{
+    submitFinishedCopies();
+
+    size_t batchCount = 0;
+    while (m_submitPos.stage < bldTab.size()) {
+        const BuilderList &bldList(bldTab[m_submitPos.stage]);
+        if (m_submitPos.index >= bldList.size()) {
+            ++m_submitPos.stage;
+            m_submitPos.index = 0;
+            continue;
+        }
+        Builder *b = bldList[m_submitPos.index];
+        if (b->type() == Builder::Type::CopyCommandList) {
+            // in m_pendingCopies, never holds up the direct queue
+            ++m_submitPos.index;
+            continue;
+        }
+        if (!m_buildGraph.isDone(b))
+            break;
+        ID3D12CommandList *cmdList = b->commandList(m_currentFrameSlot);
+        if (cmdList) {
+            if (b->hasCopyDependency()) {
+                // b being done means its copy builders are done too, possibly
+                // only since the scan above
+                submitFinishedCopies();
+                if (batchCount) {
+                    Trace::Scope traceScope("ExecuteCommandLists");
+                    m_backend->executeCommandLists(UINT(batchCount), m_cmdListBatch.data());
+                    batchCount = 0;
+                }
+                queueWaitForCopies();
+            }
+            if (m_cmdListBatch.size() <= batchCount)
+                m_cmdListBatch.resize(batchCount + 1);
+            m_cmdListBatch[batchCount++] = cmdList;
+        }
+        ++m_submitPos.index;
+    }
+
+    if (batchCount) {
+        Trace::Scope traceScope("ExecuteCommandLists");
+        m_backend->executeCommandLists(UINT(batchCount), m_cmdListBatch.data());
+    }
+
+    return m_submitPos.stage >= bldTab.size() && m_pendingCopies.empty();
+}
+
+void App::kickPipelinedBuild()
+{
+    beginFrame();
+    m_pipelineBldTab = m_frameFunc ? m_frameFunc() : nullptr;
+    if (m_pipelineBldTab) {
+        if (!m_pipelineThread)
+            m_pipelineThread = new std::thread(std::bind(&App::runPipelineThread, this));
+        m_pipelineLatch.arm(1);
+        m_pipelineKickEvent.set();
+    }
+    m_pipelineFramePending = true;
+}
+
+void App::renderPipelined()
+{
+    if (!m_pipelineFramePending)
+        kickPipelinedBuild();
+
+    if (m_pipelineBldTab) {
+        Trace::Scope traceScope("App::waitForPipelinedBuild");
+        const Timestamp waitTime;
+        m_pipelineLatch.wait();
+        if (ENABLE_BUILD_STATS)
+            m_fanInWait.record(waitTime.elapsedNs());
+    }
+
+    // The lists for the built frame must be collected before the frame func
+    // runs again, since it is free to reuse the same BuilderTable.
+    prepareSubmit(m_pipelineBldTab);
+    m_pipelineFramePending = false;
+
+    // Queue frame N before beginFrame for N+1 waits for N-1 (the previous use
+    // of its slot), otherwise the GPU goes idle between the two and only one
+    // frame is ever in flight.
+    executeFrame();
+    m_buildFrameSlot = (m_currentFrameSlot + 1) % SWAPCHAIN_BUFFER_COUNT;
+    kickPipelinedBuild();
+
+    presentFrame();
+}
+
+void App::drainPipeline()
+{
+    if (!m_pipelineFramePending)
+        return;
+
+    // the frame being built is dropped, its command lists are never submitted
+    if (m_pipelineBldTab)
+        m_pipelineLatch.wait();
+    m_pipelineFramePending = false;
+    m_pipelineBldTab = nullptr;
+    m_buildFrameSlot = m_currentFrameSlot;
+}
+
+void App::runPipelineThread()
+{
+    Trace::setThreadName("Pipelined build thread");
+    for (; ;) {
+        m_pipelineKickEvent.wait();
+        if (m_pipelineQuit)
+            return;
+        postToBuildersAndWait(Builder::Event::Build, *m_pipelineBldTab);
+        m_pipelineLatch.countDown();
+    }
+}
+
 App *g_app = nullptr;
 
-App::App(HINSTANCE hInstance, HWND hWnd, Builder::ThreadModel threadModel)
+App::App(HINSTANCE hInstance, HWND hWnd, Builder::ThreadModel threadModel, GpuBackend *backend)
     : m_hInstance(hInstance),
       m_hWnd(hWnd),
-      m_threadModel(threadModel)
+      m_threadModel(threadModel),
+#ifdef _WIN32
+      m_backend(backend ? backend : new D3D12Backend),
+#else
+      m_backend(backend ? backend : new NullBackend),
+#endif
+      m_pipelined(PIPELINED_FRAME_BUILD),
+      m_earlySubmit(EARLY_SUBMIT)
 {
     g_app = this;
+    Trace::setThreadName("Main thread");
+    if (m_threadModel == Builder::ThreadModel::JobSystem)
+        m_jobSystem.start();
+    else if (READBACK_RING_SIZE)
+        m_jobSystem.start(1); // for readback callbacks only
 }
 
 App::~App()
 {
+    if (m_pipelineThread) {
+        drainPipeline();
+        m_pipelineQuit = true;
+        m_pipelineKickEvent.set();
+        m_pipelineThread->join();
+        delete m_pipelineThread;
+    }
     for (Builder *b : m_builders) {
         b->finish();
         delete b;
     }
-    for (HANDLE event : m_waitEvents)
-        CloseHandle(event);
+    m_jobSystem.stop();
+    delete m_backend;
     g_app = nullptr;
 }
 
@@ -465,6 +686,55 @@ void App::deleteBuilder(Builder *b)
     }
 }
 
+void App::compactDescriptorHeaps()
+{
+    if (!m_backend->isInitialized())
+        return;
+
+    Trace::Scope traceScope("App::compactDescriptorHeaps");
+    drainPipeline();
+    waitGpu();
+    m_descHeapMgr.flushThreadCache();
+    UINT released = 0;
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+        released += m_descHeapMgr.compact(D3D12_DESCRIPTOR_HEAP_TYPE(i));
+    log("Descriptor heap compaction released %u heap(s)", released);
+}
+
+void App::logBuildStats()
+{
+    if (!ENABLE_BUILD_STATS) {
+        log("Build stats are not recorded, see ENABLE_BUILD_STATS");
+        return;
+    }
+    log("Frame build fan-in wait: frames %llu p50 %lld us p99 %lld us max %lld us",
+        m_fanInWait.count(), m_fanInWait.percentile(50) / 1000,
+        m_fanInWait.percentile(99) / 1000, m_fanInWait.maxValue() / 1000);
+
+    // slowest first, the top entry is the one most likely to set the critical path
+    BuilderList sorted = m_builders;
+    std::sort(sorted.begin(), sorted.end(), [](const Builder *a, const Builder *b) {
+        return a->buildTimeStats().percentile(99) > b->buildTimeStats().percentile(99);
+    });
+    for (const Builder *b : sorted) {
+        const Histogram &build(b->buildTimeStats());
+        const Histogram &queue(b->queueWaitStats());
+        if (!build.count())
+            continue;
+        log("  %s (%p): builds %llu build p50 %lld us p99 %lld us max %lld us, queue wait p50 %lld us p99 %lld us max %lld us",
+            b->name(), b, build.count(),
+            build.percentile(50) / 1000, build.percentile(99) / 1000, build.maxValue() / 1000,
+            queue.percentile(50) / 1000, queue.percentile(99) / 1000, queue.maxValue() / 1000);
+    }
+}
+
+void App::resetBuildStats()
+{
+    m_fanInWait.reset();
+    for (Builder *b : m_builders)
+        b->resetStats();
+}
+
 void App::postToAllBuildersAndWait(Builder::Event e)
 {
     postToBuildersAndWait(e, m_builders);
@@ -472,28 +742,36 @@ void App::postToAllBuildersAndWait(Builder::Event e)
 
 void App::postToBuildersAndWait(Builder::Event e, const BuilderTable &bldTab)
 {
+    if (BuildGraph::hasExplicitDependencies(bldTab)) {
+        m_buildGraph.dispatch(e, bldTab, &m_buildLatch);
+        m_buildLatch.wait();
+        return;
+    }
+
     for (const BuilderList &bldList : bldTab)
         postToBuildersAndWait(e, bldList);
 }
 
 void App::postToBuildersAndWait(Builder::Event e, const BuilderList &builders)
 {
-    if (m_threadModel == Builder::ThreadModel::Threaded) {
-        const size_t builderCount = builders.size();
-        const size_t batchSize = min(builderCount, MAXIMUM_WAIT_OBJECTS);
-        const size_t existingSize = m_waitEvents.size();
-        if (batchSize > existingSize) {
-            m_waitEvents.resize(batchSize);
-            for (size_t i = existingSize; i < batchSize; ++i)
-                m_waitEvents[i] = CreateEvent(nullptr, false, false, nullptr);
+    if (m_threadModel != Builder::ThreadModel::NonThreaded) {
+        int count = 0;
+        for (Builder *b : builders) {
+            if (!b->skipsEvent(e, m_buildFrameSlot))
+                ++count;
         }
-        for (size_t batchStart = 0; batchStart < builderCount; batchStart += batchSize) {
-            for (size_t i = 0; i < batchSize; ++i)
-                builders[batchStart + i]->postEvent(e, m_waitEvents[i]);
-            WaitForMultipleObjects(batchSize, m_waitEvents.data(), true, INFINITE);
+        if (!count)
+            return;
+        m_buildLatch.arm(count);
+        for (Builder *b : builders) {
+            if (!b->skipsEvent(e, m_buildFrameSlot))
+                b->postEvent(e, &m_buildLatch);
         }
+        m_buildLatch.wait();
     } else {
-        for (Builder *b : builders)
-            b->postEvent(e);
+        for (Builder *b : builders) {
+            if (!b->skipsEvent(e, m_buildFrameSlot))
+                b->postEvent(e);
+        }
     }
 }
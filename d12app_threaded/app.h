@@ -2,13 +2,26 @@
 #define APP_H
 
 #include "common.h"
+#include "gpubackend.h"
 #include "descheapmgr.h"
+#include "descring.h"
+#include "bindless.h"
+#include "resheap.h"
+#include "uploadring.h"
+#include "readbackring.h"
+#include "bufferpool.h"
+#include "jobsystem.h"
 #include "timestamp.h"
+#include "trace.h"
 #include "builder.h"
+#include "buildgraph.h"
 
 struct App
 {
-    App(HINSTANCE hInstance, HWND hWnd, Builder::ThreadModel threadModel = Builder::ThreadModel::Threaded);
+    // Takes ownership of backend, null means D3D12Backend (NullBackend
+    // without the Windows SDK). hWnd may be null with NullBackend.
+    App(HINSTANCE hInstance, HWND hWnd, Builder::ThreadModel threadModel = Builder::ThreadModel::Threaded,
+        GpuBackend *backend = nullptr);
     ~App();
 
     bool initialize();
@@ -17,14 +30,54 @@ struct App
     void render();
     void resize(UINT newWidth, UINT newHeight);
     void logVidMemUsage();
+    // Waits for the builders and the GPU, then runs DescHeapMgr::compact() for all types.
+    void compactDescriptorHeaps();
 
     void bumpFrameFence();
-    void waitForFrameFence();
+    void waitForFrameFence(UINT frameSlot);
+    // Executes the first count lists of m_copyListBatch on the copy queue and signals the copy fence.
+    void submitCopyBatch(size_t count);
+    // Makes the direct queue wait for everything submitted to the copy queue so far.
+    void queueWaitForCopies();
+    // The frame fence value that covers everything recorded so far, including
+    // the frame being built. Safe to call from builders.
+    UINT64 pendingFrameFenceValue() const { return m_lastFrameFenceValue.load() + (m_pipelined ? 2 : 1); }
+    // Frees descriptors once the frames that may still use them are done.
+    void releaseDescriptorsDeferred(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n)
+    {
+        m_descHeapMgr.releaseDeferred(handle, n, pendingFrameFenceValue());
+    }
+    // Frees a BindlessTable index once the frames that may still use it are done.
+    void releaseBindlessIndex(UINT index) { m_bindless.release(index, pendingFrameFenceValue()); }
+    // Returns a BufferPool buffer once the frames that may still use it are done.
+    void releasePooledBuffer(ID3D12Resource *buffer) { m_bufferPool.release(buffer, pendingFrameFenceValue()); }
     bool createSwapchainViews();
     void releaseSwapchainViews();
     void handleLostDevice();
     void beginFrame();
     void endFrame(const BuilderTable *bldTab);
+    void prepareSubmit(const BuilderTable *bldTab);
+    // executeFrame() and presentFrame() in one go
+    void submitFrame();
+    void executeFrame();
+    void presentFrame();
+    void buildAndSubmitEarly(const BuilderTable &bldTab);
+    bool submitFinishedBuilders(const BuilderTable &bldTab);
+    void submitFinishedCopies();
+
+    // Pipelined mode: builders record frame N+1 into the next slot while the
+    // main thread submits and presents frame N. Frame N is queued before the
+    // wait for N-1 that frees that slot, so the GPU has as many frames in
+    // flight as without pipelining. Switch only while idle.
+    void setPipelined(bool enable) { drainPipeline(); m_pipelined = enable; }
+    bool isPipelined() const { return m_pipelined; }
+    // Submit builders as soon as a contiguous run of them is done. Ignored when pipelined.
+    void setEarlySubmit(bool enable) { m_earlySubmit = enable; }
+    bool isEarlySubmit() const { return m_earlySubmit; }
+    void renderPipelined();
+    void kickPipelinedBuild();
+    void drainPipeline();
+    void runPipelineThread();
 
     void requestUpdate() { m_needsRender = true; }
     void maybeUpdate() { if (m_needsRender) render(); }
@@ -34,6 +87,11 @@ struct App
     void addBuilders(std::initializer_list<Builder *> args);
     void deleteBuilder(Builder *b);
 
+    // Time the main thread spends waiting for the builders of a frame.
+    const Histogram &fanInWaitStats() const { return m_fanInWait; }
+    void logBuildStats();
+    void resetBuildStats();
+
     void postToAllBuildersAndWait(Builder::Event e);
     void postToBuildersAndWait(Builder::Event e, const BuilderTable &bldTab);
     void postToBuildersAndWait(Builder::Event e, const BuilderList &builders);
@@ -51,33 +109,60 @@ struct App
     HINSTANCE m_hInstance;
     HWND m_hWnd;
     Builder::ThreadModel m_threadModel;
+    JobSystem m_jobSystem;
     UINT m_width = DEFAULT_WIDTH;
     UINT m_height = DEFAULT_HEIGHT;
     bool m_zeroSize = false;
-    IDXGIFactory3 *m_dxgiFactory = nullptr;
-    IDXGIAdapter3 *m_adapter = nullptr;
-    ID3D12Device *m_device = nullptr;
+    GpuBackend *m_backend;
+    ID3D12Device *m_device = nullptr; // null with a backend that has no real device
     D3D12_FEATURE_DATA_D3D12_OPTIONS m_features = {};
     D3D12_FEATURE_DATA_ARCHITECTURE m_archFeatures = {};
-    ID3D12CommandQueue *m_cmdQueue = nullptr;
-    IDXGISwapChain3 *m_swapchain = nullptr;
-    UINT m_currentFrameSlot; // 0..FRAMES_IN_FLIGHT-1
-    ID3D12Fence *m_frameFence = nullptr;
-    UINT64 m_lastFrameFenceValue = 0;
+    UINT m_currentFrameSlot; // 0..FRAMES_IN_FLIGHT-1, the slot submitted and presented next
+    UINT m_buildFrameSlot; // the slot builders record into, same as m_currentFrameSlot unless pipelined
+    std::atomic<UINT64> m_lastFrameFenceValue { 0 };
     UINT64 m_frameFenceValues[SWAPCHAIN_BUFFER_COUNT] = {};
-    HANDLE m_frameFenceEvent = nullptr;
+    UINT64 m_lastCopyFenceValue = 0;
+    UINT64 m_copyFrameFenceValues[SWAPCHAIN_BUFFER_COUNT] = {}; // covers the copy lists submitted for the slot
+    UINT64 m_copyWaitedValue = 0; // the direct queue already waits for this much
     DescHeapMgr m_descHeapMgr;
+    DescRing m_descRing;
+    ResHeapAllocator m_resHeapAllocator; // not initialized without a device or when RESOURCE_HEAP_SIZE is 0
+    UploadRing m_uploadRing; // not initialized without a device
+    ReadbackRing m_readbackRing; // not initialized without a device or when READBACK_RING_SIZE is 0
+    BufferPool m_bufferPool; // not initialized without a device
+    BindlessTable m_bindless; // not initialized when BINDLESS_TABLE_SIZE is 0 or the binding tier is too low
     ID3D12Resource *m_rt[SWAPCHAIN_BUFFER_COUNT] = {};
     D3D12_CPU_DESCRIPTOR_HANDLE m_rtv[SWAPCHAIN_BUFFER_COUNT] = {};
     ID3D12Resource *m_ds = nullptr;
     D3D12_CPU_DESCRIPTOR_HANDLE m_dsv = {};
     ID3D12CommandAllocator *m_cmdAllocator[FRAMES_IN_FLIGHT] = {};
-    ID3D12GraphicsCommandList *m_mainThreadDrawCmdList[2] = {};
+    ID3D12GraphicsCommandList *m_mainThreadDrawCmdList[FRAMES_IN_FLIGHT][2] = {};
     bool m_needsRender = false;
     Timestamp m_renderTimestamp;
     BuilderList m_builders;
-    std::vector<HANDLE> m_waitEvents;
+    Latch m_buildLatch;
+    Histogram m_fanInWait;
+    BuildGraph m_buildGraph;
     std::vector<ID3D12CommandList *> m_cmdListBatch;
+    size_t m_cmdListBatchCount = 0;
+    std::vector<ID3D12CommandList *> m_copyListBatch;
+    size_t m_copyListBatchCount = 0;
+    size_t m_copyWaitPos = 0; // first list in m_cmdListBatch that consumes uploads, m_cmdListBatchCount if none
+    BuilderList m_pendingCopies; // copy builders of an early submitted frame not yet submitted
+    WaitEvent m_buildProgressEvent;
+    bool m_frameBeginSubmitted = false;
+    struct {
+        size_t stage;
+        size_t index;
+    } m_submitPos = {}; // first builder of the table not yet submitted
+    bool m_pipelined;
+    bool m_earlySubmit;
+    bool m_pipelineFramePending = false;
+    const BuilderTable *m_pipelineBldTab = nullptr;
+    std::thread *m_pipelineThread = nullptr;
+    WaitEvent m_pipelineKickEvent;
+    Latch m_pipelineLatch;
+    bool m_pipelineQuit = false;
     FrameFunc m_frameFunc = nullptr;
     std::vector<FrameExtraFunc> m_preFrameFuncs;
     std::vector<FrameExtraFunc> m_postFrameFuncs;
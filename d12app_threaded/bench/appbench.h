@@ -0,0 +1,97 @@
+#ifndef APPBENCH_H
+#define APPBENCH_H
+
+#include "app.h"
+#include "nullbackend.h"
+#include "histogram.h"
+#include "bench.h"
+
+// Drives App::render against NullBackend with builders that only burn CPU,
+// so what is measured is the frame machinery itself.
+
+struct BusyBuilder : Builder
+{
+    BusyBuilder(int work) : Builder(Type::GraphicsCommandList), m_work(work) { }
+    void processEvent(Event e) override
+    {
+        if (e == Event::Build)
+            benchBusyWork(m_work);
+    }
+    int m_work;
+};
+
+struct FrameLoop
+{
+    Builder::ThreadModel threadModel = Builder::ThreadModel::JobSystem;
+    int builderCount = 32;
+    int stageCount = 2;
+    int builderWork = 20000;
+    INT64 gpuCostNs = 20000; // per command list
+    bool pipelined = false;
+    bool earlySubmit = false;
+    int warmupFrames = 0; // rendered but not measured
+    int frameCount = 100;
+
+    struct Result {
+        double usPerFrame;
+        INT64 p50Ns;
+        INT64 p99Ns;
+        UINT64 executedCommandLists;
+        bool ok;
+    };
+    Result run() const;
+};
+
+inline const char *threadModelName(Builder::ThreadModel m)
+{
+    switch (m) {
+    case Builder::ThreadModel::Threaded:
+        return "threaded";
+    case Builder::ThreadModel::JobSystem:
+        return "jobsystem";
+    default:
+        return "nonthreaded";
+    }
+}
+
+inline FrameLoop::Result FrameLoop::run() const
+{
+    NullBackend *backend = new NullBackend(gpuCostNs);
+    App app(nullptr, nullptr, threadModel, backend);
+    app.setPipelined(pipelined);
+    app.setEarlySubmit(earlySubmit);
+    BuilderTable bldTab(stageCount);
+    for (int i = 0; i < builderCount; ++i) {
+        Builder *b = new BusyBuilder(builderWork);
+        app.addBuilder(b);
+        bldTab[i % stageCount].push_back(b);
+    }
+    app.setFrameFunc([&bldTab] { return &bldTab; });
+
+    for (int frame = 0; frame < warmupFrames; ++frame)
+        app.render();
+    const UINT64 presentsBefore = backend->stats().presents;
+    const UINT64 listsBefore = backend->stats().executedCommandLists;
+
+    Histogram frameTime;
+    Timestamp total;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        Timestamp t;
+        app.render();
+        frameTime.record(t.elapsedNs());
+    }
+    const INT64 totalNs = total.elapsedNs();
+
+    Result r;
+    r.usPerFrame = totalNs / 1000.0 / frameCount;
+    r.p50Ns = frameTime.percentile(50);
+    r.p99Ns = frameTime.percentile(99);
+    r.executedCommandLists = backend->stats().executedCommandLists - listsBefore;
+    // pipelined frames are submitted one render() late
+    r.ok = backend->stats().presents - presentsBefore == UINT64(frameCount)
+        && r.executedCommandLists >= UINT64(frameCount - 1) * builderCount;
+    app.releaseResources();
+    return r;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "platform.h"
+#include "timestamp.h"
+
+// Shared bits for the headless benchmarks. Each one runs a full pass by
+// default, --quick shrinks the iteration counts so ctest can smoke-run it.
+
+inline bool benchQuick(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--quick"))
+            return true;
+    }
+    return false;
+}
+
+inline int benchIterations(int argc, char **argv, int full, int quick)
+{
+    return benchQuick(argc, argv) ? quick : full;
+}
+
+inline void benchBusyWork(int n)
+{
+    volatile int x = 0;
+    for (int i = 0; i < n; ++i)
+        x += i;
+}
+
+#endif
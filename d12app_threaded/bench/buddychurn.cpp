@@ -0,0 +1,64 @@
+#include "buddyallocator.h"
+#include "bench.h"
+#include <random>
+
+// Allocate/release churn on a 64 MB BuddyAllocator with 64 KB blocks, the
+// ResHeapAllocator setup, at a few live set sizes. Reports the cost per
+// operation and how fragmented the heap ends up.
+
+namespace {
+
+const UINT64 HEAP_SIZE = 64 * 1024 * 1024;
+const UINT64 MIN_BLOCK_SIZE = 64 * 1024;
+
+void churn(int liveCount, int opCount)
+{
+    BuddyAllocator a;
+    a.initialize(HEAP_SIZE, MIN_BLOCK_SIZE);
+    std::mt19937 rng(liveCount);
+    // mostly single blocks, with the occasional large texture
+    std::uniform_int_distribution<int> shape(0, 15);
+    std::uniform_int_distribution<UINT64> smallSize(1, 4 * MIN_BLOCK_SIZE);
+    std::uniform_int_distribution<UINT64> largeSize(1, HEAP_SIZE / 16);
+    std::vector<UINT64> live;
+    live.reserve(liveCount);
+
+    int failures = 0;
+    Timestamp t;
+    bool full = false;
+    for (int op = 0; op < opCount; ++op) {
+        // a failed allocation evicts something, like a heap that is full would
+        if ((full || int(live.size()) >= liveCount) && !live.empty()) {
+            const size_t i = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+            a.release(live[i]);
+            live[i] = live.back();
+            live.pop_back();
+        }
+        const UINT64 size = shape(rng) ? smallSize(rng) : largeSize(rng);
+        UINT64 offset;
+        full = !a.allocate(size, MIN_BLOCK_SIZE, &offset);
+        if (full)
+            ++failures;
+        else
+            live.push_back(offset);
+    }
+    const INT64 ns = t.elapsedNs();
+
+    const UINT64 freeBytes = a.size() - a.used();
+    printf("live up to %4d: %6.1f ns/op, %d failed allocations, ended with %llu live, %llu KB free, largest free block %llu KB\n",
+        liveCount, double(ns) / opCount, failures, (unsigned long long)live.size(), (unsigned long long)(freeBytes / 1024),
+        (unsigned long long)(a.largestFreeBlock() / 1024));
+    for (UINT64 offset : live)
+        a.release(offset);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const int opCount = benchIterations(argc, argv, 1000000, 10000);
+    churn(16, opCount);
+    churn(64, opCount);
+    churn(256, opCount);
+    return 0;
+}
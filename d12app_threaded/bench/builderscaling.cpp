@@ -0,0 +1,29 @@
+#include "appbench.h"
+
+// Thread per builder against builders as JobSystem tasks, at 8, 64 and 512
+// builders with little work each, so scheduling cost dominates the frame.
+
+int main(int argc, char **argv)
+{
+    const int frameCount = benchIterations(argc, argv, 500, 20);
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    bool ok = true;
+    for (int builderCount : { 8, 64, 512 }) {
+        for (Builder::ThreadModel threadModel : { Builder::ThreadModel::Threaded, Builder::ThreadModel::JobSystem }) {
+            FrameLoop loop;
+            loop.threadModel = threadModel;
+            loop.builderCount = builderCount;
+            loop.stageCount = 4;
+            loop.builderWork = 2000;
+            loop.gpuCostNs = 0;
+            loop.warmupFrames = 10;
+            loop.frameCount = frameCount;
+            const FrameLoop::Result r = loop.run();
+            printf("%3d builders %-9s: %8.1f us/frame, p50 %8.1f us, p99 %8.1f us%s\n",
+                builderCount, threadModelName(threadModel), r.usPerFrame, r.p50Ns / 1000.0, r.p99Ns / 1000.0,
+                r.ok ? "" : " (MISMATCH)");
+            ok &= r.ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include "descheapmgr.h"
+#include "nullbackend.h"
+#include "bench.h"
+#include <random>
+
+// 100k allocate/release pairs of 1..64 descriptor ranges on one 64K
+// descriptor heap held at increasing occupancy, so findFreeRun has to skip
+// more and more of the freeMap. The lock hold time is mostly the search.
+// Ranges that no longer fit anywhere go to a second heap, counted as spills.
+
+namespace {
+
+const D3D12_DESCRIPTOR_HEAP_TYPE TYPE = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+const UINT HEAP_SIZE = 65536;
+
+void churn(double occupancy, int opCount)
+{
+    NullBackend backend;
+    backend.initialize(nullptr, 1, 1);
+    DescHeapMgr mgr;
+    mgr.initialize(&backend);
+    mgr.setHeapPolicy(TYPE, { HEAP_SIZE, HEAP_SIZE, 1 });
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<UINT> size(2, 64);
+    std::vector<DescHeapMgr::Range> live;
+    const D3D12_CPU_DESCRIPTOR_HANDLE first = mgr.allocate(TYPE, 1);
+    live.push_back({ first, 1 });
+    const SIZE_T heapEnd = first.ptr + SIZE_T(HEAP_SIZE) * NullBackend::HANDLE_SIZE;
+    UINT used = 1;
+    while (used < UINT(HEAP_SIZE * occupancy)) {
+        const UINT n = size(rng);
+        live.push_back({ mgr.allocate(TYPE, n), n });
+        used += n;
+    }
+
+    int spills = 0;
+    Timestamp t;
+    for (int op = 0; op < opCount; ++op) {
+        DescHeapMgr::Range &r(live[std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng)]);
+        mgr.release(r.handle, r.n);
+        r.n = size(rng);
+        r.handle = mgr.allocate(TYPE, r.n);
+        if (r.handle.ptr < first.ptr || r.handle.ptr >= heapEnd)
+            ++spills;
+    }
+    const INT64 ns = t.elapsedNs();
+
+    const DescHeapMgr::TypeStats s = mgr.stats().types[TYPE];
+    printf("occupancy %2.0f%%: %6.1f ns per release+allocate, lock hold mean %5.2f us p50 %5.2f us p99 %5.2f us, largest free run %u of %u free, %d spills\n",
+        occupancy * 100, double(ns) / opCount, mgr.lockHoldStats().mean() / 1000.0, mgr.lockHoldStats().percentile(50) / 1000.0,
+        mgr.lockHoldStats().percentile(99) / 1000.0, s.largestFreeRun, s.capacity - s.used,
+        spills);
+    mgr.releaseResources();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const int opCount = benchIterations(argc, argv, 100000, 5000);
+    for (double occupancy : { 0.5, 0.75, 0.9, 0.95 })
+        churn(occupancy, opCount);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include "appbench.h"
+
+// App::render under each thread model, 32 builders in 2 stages.
+
+int main(int argc, char **argv)
+{
+    const int frameCount = benchIterations(argc, argv, 2000, 100);
+    bool ok = true;
+    for (Builder::ThreadModel threadModel : { Builder::ThreadModel::NonThreaded, Builder::ThreadModel::Threaded,
+        Builder::ThreadModel::JobSystem }) {
+        FrameLoop loop;
+        loop.threadModel = threadModel;
+        loop.frameCount = frameCount;
+        const FrameLoop::Result r = loop.run();
+        printf("%-11s %d builders %d frames: %.1f us/frame, p50 %.1f us, p99 %.1f us, %llu lists%s\n",
+            threadModelName(threadModel), loop.builderCount, frameCount, r.usPerFrame, r.p50Ns / 1000.0, r.p99Ns / 1000.0,
+            (unsigned long long)r.executedCommandLists, r.ok ? "" : " (MISMATCH)");
+        ok &= r.ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "sync.h"
+#include "jobsystem.h"
+#include "histogram.h"
+#include "bench.h"
+
+// Fan-in of 200 builder completions: one Latch counted down by every job
+// against an event per builder that the waiter goes through one by one, which
+// is how completion was waited for before. The jobs run on a JobSystem and do
+// a little work, the time is from submitting them to the waiter returning.
+
+namespace {
+
+const int BUILDER_COUNT = 200;
+const int JOB_WORK = 2000;
+
+struct LatchFanIn
+{
+    static void job(void *data)
+    {
+        benchBusyWork(JOB_WORK);
+        static_cast<LatchFanIn *>(data)->latch.countDown();
+    }
+    void arm() { latch.arm(BUILDER_COUNT); }
+    void *jobData(int) { return this; }
+    void wait() { latch.wait(); }
+    Latch latch;
+};
+
+struct EventFanIn
+{
+    static void job(void *data)
+    {
+        benchBusyWork(JOB_WORK);
+        static_cast<WaitEvent *>(data)->set();
+    }
+    void arm() { }
+    void *jobData(int i) { return &events[i]; }
+    void wait()
+    {
+        for (WaitEvent &e : events)
+            e.wait();
+    }
+    WaitEvent events[BUILDER_COUNT];
+};
+
+template<typename FanIn>
+void measure(const char *name, JobSystem *jobSystem, int roundCount)
+{
+    FanIn fanIn;
+    Histogram roundTime;
+    for (int round = 0; round < roundCount; ++round) {
+        Timestamp t;
+        fanIn.arm();
+        for (int i = 0; i < BUILDER_COUNT; ++i)
+            jobSystem->submit({ &FanIn::job, fanIn.jobData(i) });
+        fanIn.wait();
+        roundTime.record(t.elapsedNs());
+    }
+    printf("%-16s %d builders: mean %7.1f us, p50 %7.1f us, p99 %7.1f us\n", name, BUILDER_COUNT,
+        roundTime.mean() / 1000.0, roundTime.percentile(50) / 1000.0, roundTime.percentile(99) / 1000.0);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const int roundCount = benchIterations(argc, argv, 2000, 50);
+    JobSystem jobSystem;
+    jobSystem.start();
+    measure<LatchFanIn>("Latch", &jobSystem, roundCount);
+    measure<EventFanIn>("event per builder", &jobSystem, roundCount);
+    return 0;
+}
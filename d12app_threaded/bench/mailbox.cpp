@@ -0,0 +1,91 @@
+#include "sync.h"
+#include "histogram.h"
+#include "bench.h"
+#include <queue>
+
+// Post-to-wakeup latency of a builder's Mailbox against the mutex, condition
+// variable and std::queue it replaced. One producer posts timestamped messages
+// to one consumer, spaced out so the consumer has gone idle (spun out and
+// parked) or back to back, which is the throughput case.
+
+namespace {
+
+struct Msg {
+    Timestamp posted;
+    bool quit;
+};
+
+struct MailboxChannel
+{
+    void post(const Msg &msg) { mailbox.post(msg, &event); }
+    void take(Msg *msg) { mailbox.take(msg, &event); }
+    Mailbox<Msg, 256> mailbox;
+    WaitEvent event;
+};
+
+struct MutexQueueChannel
+{
+    void post(const Msg &msg)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push(msg);
+        }
+        cond.notify_one();
+    }
+    void take(Msg *msg)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return !queue.empty(); });
+        *msg = queue.front();
+        queue.pop();
+    }
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::queue<Msg> queue;
+};
+
+template<typename Channel>
+void measure(const char *name, int messageCount, int gapUs)
+{
+    Channel channel;
+    Histogram latency;
+    std::thread consumer([&channel, &latency] {
+        for (; ;) {
+            Msg msg;
+            channel.take(&msg);
+            if (msg.quit)
+                break;
+            latency.record(msg.posted.elapsedNs());
+        }
+    });
+
+    Timestamp total;
+    for (int i = 0; i < messageCount; ++i) {
+        if (gapUs)
+            std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+        channel.post({ Timestamp(), false });
+    }
+    channel.post({ Timestamp(), true });
+    consumer.join();
+    const INT64 totalNs = total.elapsedNs();
+
+    printf("%-16s gap %4d us: p50 %7.1f us, p99 %7.1f us, max %8.1f us, %.0f ns/message overall\n",
+        name, gapUs, latency.percentile(50) / 1000.0, latency.percentile(99) / 1000.0, latency.maxValue() / 1000.0,
+        double(totalNs) / messageCount);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const int spacedCount = benchIterations(argc, argv, 5000, 200);
+    const int burstCount = benchIterations(argc, argv, 1000000, 10000);
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    for (int gapUs : { 0, 50, 1000 }) {
+        const int count = gapUs ? spacedCount : burstCount;
+        measure<MailboxChannel>("Mailbox", count, gapUs);
+        measure<MutexQueueChannel>("mutex+std::queue", count, gapUs);
+    }
+    return 0;
+}
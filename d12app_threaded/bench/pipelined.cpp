@@ -0,0 +1,28 @@
+#include "appbench.h"
+
+// Steady-state frame time with and without pipelined building, from CPU-bound
+// to GPU-bound. Pipelining should win when both sides take about as long and
+// match the non-pipelined GPU-bound time. With a single core there is nothing
+// to overlap the build with, so only the extra handoff shows.
+
+int main(int argc, char **argv)
+{
+    const int frameCount = benchIterations(argc, argv, 300, 30);
+    bool ok = true;
+    for (INT64 gpuCostNs : { 25000, 100000, 200000 }) {
+        for (bool pipelined : { false, true }) {
+            FrameLoop loop;
+            loop.builderWork = 100000;
+            loop.gpuCostNs = gpuCostNs;
+            loop.pipelined = pipelined;
+            loop.warmupFrames = 20;
+            loop.frameCount = frameCount;
+            const FrameLoop::Result r = loop.run();
+            printf("gpu %3lld us/list %-12s %d frames: %.1f us/frame, p50 %.1f us, p99 %.1f us%s\n",
+                (long long)(gpuCostNs / 1000), pipelined ? "pipelined" : "not pipelined", frameCount, r.usPerFrame,
+                r.p50Ns / 1000.0, r.p99Ns / 1000.0, r.ok ? "" : " (MISMATCH)");
+            ok &= r.ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
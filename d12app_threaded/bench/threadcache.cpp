@@ -0,0 +1,70 @@
+#include "descheapmgr.h"
+#include "nullbackend.h"
+#include "bench.h"
+
+// Single descriptor allocate/release from several threads at once, through
+// the per-thread caches (non-shader-visible) and through the locked path
+// (shader-visible, which is never cached). Each thread keeps a window of live
+// descriptors and replaces the oldest.
+
+namespace {
+
+const D3D12_DESCRIPTOR_HEAP_TYPE TYPE = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+const int WINDOW = 64;
+
+void contend(int threadCount, D3D12_DESCRIPTOR_HEAP_FLAGS flags, int opsPerThread)
+{
+    NullBackend backend;
+    backend.initialize(nullptr, 1, 1);
+    DescHeapMgr mgr;
+    mgr.initialize(&backend);
+
+    std::atomic<int> ready { 0 };
+    std::atomic<bool> go { false };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&mgr, &ready, &go, flags, opsPerThread] {
+            D3D12_CPU_DESCRIPTOR_HANDLE window[WINDOW];
+            for (D3D12_CPU_DESCRIPTOR_HANDLE &h : window)
+                h = mgr.allocate(TYPE, 1, flags);
+            ++ready;
+            while (!go.load())
+                std::this_thread::yield();
+            for (int op = 0; op < opsPerThread; ++op) {
+                D3D12_CPU_DESCRIPTOR_HANDLE &h(window[op % WINDOW]);
+                mgr.release(h, 1);
+                h = mgr.allocate(TYPE, 1, flags);
+            }
+            for (D3D12_CPU_DESCRIPTOR_HANDLE &h : window)
+                mgr.release(h, 1);
+            mgr.flushThreadCache();
+        });
+    }
+    while (ready.load() < threadCount)
+        std::this_thread::yield();
+    mgr.resetLockStats();
+    Timestamp t;
+    go = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    const INT64 ns = t.elapsedNs();
+
+    const UINT64 opCount = UINT64(threadCount) * opsPerThread;
+    printf("%d threads %-14s: %7.1f ns per release+allocate overall, %llu lock acquisitions, lock wait mean %6.2f us p99 %6.2f us\n",
+        threadCount, flags ? "shader-visible" : "cached", double(ns) / opCount, (unsigned long long)mgr.lockWaitStats().count(),
+        mgr.lockWaitStats().mean() / 1000.0, mgr.lockWaitStats().percentile(99) / 1000.0);
+    mgr.releaseResources();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const int opsPerThread = benchIterations(argc, argv, 500000, 10000);
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    for (int threadCount : { 1, 2, 4, 8 }) {
+        contend(threadCount, D3D12_DESCRIPTOR_HEAP_FLAG_NONE, opsPerThread);
+        contend(threadCount, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, opsPerThread);
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "bindless.h"
+
+bool BindlessTable::initialize(DescRing *descRing)
+{
+    if (!descRing->heap() || !descRing->reservedCount()) {
+        log("No descriptors reserved for the bindless table");
+        return false;
+    }
+    m_heap = descRing->heap();
+    m_cpuStart = descRing->cpuStart();
+    m_gpuStart = descRing->gpuStart();
+    m_handleSize = descRing->handleSize();
+    m_capacity = descRing->reservedCount();
+    m_nextIndex = 0;
+    return true;
+}
+
+void BindlessTable::releaseResources()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_heap = nullptr;
+    m_cpuStart = {};
+    m_gpuStart = {};
+    m_capacity = 0;
+    m_nextIndex = 0;
+    m_freeIndices.clear();
+    m_deferredReleases.clear();
+}
+
+UINT BindlessTable::allocate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_freeIndices.empty()) {
+        const UINT index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+        return index;
+    }
+    if (m_nextIndex < m_capacity)
+        return m_nextIndex++;
+    log("Bindless table is full (%u descriptors)", m_capacity);
+    return INVALID_INDEX;
+}
+
+UINT BindlessTable::createShaderResourceView(ID3D12Device *dev, ID3D12Resource *resource, const D3D12_SHADER_RESOURCE_VIEW_DESC *desc)
+{
+    const UINT index = allocate();
+    if (index != INVALID_INDEX && dev)
+        dev->CreateShaderResourceView(resource, desc, cpuHandle(index));
+    return index;
+}
+
+UINT BindlessTable::createConstantBufferView(ID3D12Device *dev, const D3D12_CONSTANT_BUFFER_VIEW_DESC *desc)
+{
+    const UINT index = allocate();
+    if (index != INVALID_INDEX && dev)
+        dev->CreateConstantBufferView(desc, cpuHandle(index));
+    return index;
+}
+
+UINT BindlessTable::createUnorderedAccessView(ID3D12Device *dev, ID3D12Resource *resource, ID3D12Resource *counter,
+    const D3D12_UNORDERED_ACCESS_VIEW_DESC *desc)
+{
+    const UINT index = allocate();
+    if (index != INVALID_INDEX && dev)
+        dev->CreateUnorderedAccessView(resource, counter, desc, cpuHandle(index));
+    return index;
+}
+
+void BindlessTable::release(UINT index, UINT64 fenceValue)
+{
+    if (index >= m_capacity)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deferredReleases.push_back({ index, fenceValue });
+}
+
+void BindlessTable::reclaim(UINT64 completedFenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t kept = 0;
+    for (const DeferredRelease &r : m_deferredReleases) {
+        if (r.fenceValue <= completedFenceValue)
+            m_freeIndices.push_back(r.index);
+        else
+            m_deferredReleases[kept++] = r;
+    }
+    m_deferredReleases.resize(kept);
+}
@@ -0,0 +1,53 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include "descring.h"
+
+// The reserved front of the DescRing heap, where every view gets an index that
+// stays the same for as long as the view exists. Shaders index the unbounded
+// arrays of a root signature created with Res::BindlessLayout directly, so
+// there is nothing to copy or bind per draw. Sharing the heap lets a command
+// list use both the table and DescRing ranges.
+struct BindlessTable
+{
+    static const UINT INVALID_INDEX = ~0U;
+
+    // Takes all reserved descriptors of descRing, which must outlive the table.
+    bool initialize(DescRing *descRing);
+    void releaseResources();
+
+    // All thread-safe. The view functions skip the view creation with a null
+    // device, and return INVALID_INDEX when the table is full.
+    UINT allocate();
+    UINT createShaderResourceView(ID3D12Device *dev, ID3D12Resource *resource, const D3D12_SHADER_RESOURCE_VIEW_DESC *desc);
+    UINT createConstantBufferView(ID3D12Device *dev, const D3D12_CONSTANT_BUFFER_VIEW_DESC *desc);
+    UINT createUnorderedAccessView(ID3D12Device *dev, ID3D12Resource *resource, ID3D12Resource *counter,
+        const D3D12_UNORDERED_ACCESS_VIEW_DESC *desc);
+
+    // The index is handed out again by the first reclaim() that sees the fence
+    // at or past fenceValue.
+    void release(UINT index, UINT64 fenceValue);
+    void reclaim(UINT64 completedFenceValue);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle(UINT index) const { return { m_cpuStart.ptr + SIZE_T(index) * m_handleSize }; }
+    // For SetDescriptorHeaps and the table parameter of the root signature.
+    ID3D12DescriptorHeap *heap() const { return m_heap; }
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuStart() const { return m_gpuStart; }
+    UINT capacity() const { return m_capacity; }
+
+    ID3D12DescriptorHeap *m_heap = nullptr;
+    D3D12_CPU_DESCRIPTOR_HANDLE m_cpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE m_gpuStart = {};
+    UINT m_handleSize = 0;
+    UINT m_capacity = 0;
+    std::mutex m_mutex;
+    UINT m_nextIndex = 0; // indices from here on were never handed out
+    std::vector<UINT> m_freeIndices;
+    struct DeferredRelease {
+        UINT index;
+        UINT64 fenceValue;
+    };
+    std::vector<DeferredRelease> m_deferredReleases;
+};
+
+#endif
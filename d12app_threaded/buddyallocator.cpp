@@ -0,0 +1,106 @@
+#include "buddyallocator.h"
+
+static const UINT NO_BLOCK = ~0U;
+
+bool BuddyAllocator::initialize(UINT64 size, UINT64 minBlockSize)
+{
+    if (!minBlockSize || (minBlockSize & (minBlockSize - 1)) || (size & (size - 1)) || size < minBlockSize) {
+        log("Invalid buddy allocator size %llu with blocks of %llu", size, minBlockSize);
+        return false;
+    }
+
+    m_minBlockSize = minBlockSize;
+    m_maxOrder = bitScanReverse64(size / minBlockSize);
+    m_used = 0;
+    const UINT blockCount = UINT(size / minBlockSize);
+    m_freeHeads.assign(m_maxOrder + 1, NO_BLOCK);
+    m_next.assign(blockCount, NO_BLOCK);
+    m_prev.assign(blockCount, NO_BLOCK);
+    m_order.assign(blockCount, 0);
+    m_free.assign(blockCount, false);
+    m_allocated.assign(blockCount, false);
+    pushFree(0, m_maxOrder);
+    return true;
+}
+
+void BuddyAllocator::pushFree(UINT block, UINT order)
+{
+    m_order[block] = order;
+    m_free[block] = true;
+    m_prev[block] = NO_BLOCK;
+    m_next[block] = m_freeHeads[order];
+    if (m_next[block] != NO_BLOCK)
+        m_prev[m_next[block]] = block;
+    m_freeHeads[order] = block;
+}
+
+void BuddyAllocator::removeFree(UINT block, UINT order)
+{
+    if (m_prev[block] != NO_BLOCK)
+        m_next[m_prev[block]] = m_next[block];
+    else
+        m_freeHeads[order] = m_next[block];
+    if (m_next[block] != NO_BLOCK)
+        m_prev[m_next[block]] = m_prev[block];
+    m_free[block] = false;
+}
+
+bool BuddyAllocator::allocate(UINT64 size, UINT64 alignment, UINT64 *offset)
+{
+    const UINT64 blocks = ((std::max)((std::max)(size, alignment), m_minBlockSize) + m_minBlockSize - 1) / m_minBlockSize;
+    UINT order = bitScanReverse64(blocks);
+    if (blocks & (blocks - 1))
+        ++order;
+    if (order > m_maxOrder)
+        return false;
+
+    UINT from = order;
+    while (from <= m_maxOrder && m_freeHeads[from] == NO_BLOCK)
+        ++from;
+    if (from > m_maxOrder)
+        return false;
+
+    const UINT block = m_freeHeads[from];
+    removeFree(block, from);
+    // split, the upper halves stay free
+    while (from > order) {
+        --from;
+        pushFree(block + (1U << from), from);
+    }
+    m_order[block] = order;
+    m_allocated[block] = true;
+    m_used += m_minBlockSize << order;
+    *offset = UINT64(block) * m_minBlockSize;
+    return true;
+}
+
+void BuddyAllocator::release(UINT64 offset)
+{
+    UINT block = UINT(offset / m_minBlockSize);
+    if (offset % m_minBlockSize || block >= m_allocated.size() || !m_allocated[block]) {
+        log("Attempted to release invalid buddy allocator offset %llu", offset);
+        return;
+    }
+
+    m_allocated[block] = false;
+    UINT order = m_order[block];
+    m_used -= m_minBlockSize << order;
+    while (order < m_maxOrder) {
+        const UINT buddy = block ^ (1U << order);
+        if (!m_free[buddy] || m_order[buddy] != order)
+            break;
+        removeFree(buddy, order);
+        block = (std::min)(block, buddy);
+        ++order;
+    }
+    pushFree(block, order);
+}
+
+UINT64 BuddyAllocator::largestFreeBlock() const
+{
+    for (UINT order = m_maxOrder + 1; order > 0; --order) {
+        if (m_freeHeads[order - 1] != NO_BLOCK)
+            return m_minBlockSize << (order - 1);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef BUDDYALLOCATOR_H
+#define BUDDYALLOCATOR_H
+
+#include "platform.h"
+
+// Offsets into a range of size bytes, handed out as power-of-two blocks of
+// minBlockSize << order. Blocks are aligned to their own size, so any
+// alignment up to the size of the range can be met. Not thread-safe.
+struct BuddyAllocator
+{
+    // size and minBlockSize are powers of two, size >= minBlockSize
+    bool initialize(UINT64 size, UINT64 minBlockSize);
+    bool allocate(UINT64 size, UINT64 alignment, UINT64 *offset);
+    void release(UINT64 offset);
+
+    UINT64 size() const { return m_minBlockSize << m_maxOrder; }
+    UINT64 used() const { return m_used; }
+    // the largest block allocate() can currently succeed with, in bytes
+    UINT64 largestFreeBlock() const;
+
+private:
+    void pushFree(UINT block, UINT order);
+    void removeFree(UINT block, UINT order);
+
+    UINT64 m_minBlockSize = 0;
+    UINT m_maxOrder = 0;
+    UINT64 m_used = 0;
+    std::vector<UINT> m_freeHeads; // per order, first free block
+    // per min block, for the block starting there
+    std::vector<UINT> m_next;
+    std::vector<UINT> m_prev;
+    std::vector<UINT> m_order;
+    std::vector<bool> m_free;
+    std::vector<bool> m_allocated;
+};
+
+#endif
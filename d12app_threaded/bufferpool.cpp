@@ -0,0 +1,139 @@
+#include "bufferpool.h"
+
+bool BufferPool::initialize(ID3D12Device *dev, ResHeapAllocator *allocator)
+{
+    m_device = dev;
+    m_allocator = allocator;
+    return true;
+}
+
+void BufferPool::releaseResources()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // the GPU is idle by now, so pending buffers can go too
+    for (const DeferredRelease &r : m_deferredReleases)
+        destroy(r.buffer);
+    m_deferredReleases.clear();
+    for (auto &freeList : m_freeLists) {
+        for (ID3D12Resource *buffer : freeList.second)
+            destroy(buffer);
+    }
+    m_freeLists.clear();
+    if (!m_buffers.empty())
+        log("%llu pooled buffers still in use when releasing the buffer pool", UINT64(m_buffers.size()));
+    m_buffers.clear();
+    m_stats.bytesInUse = m_stats.bytesPending = m_stats.bytesIdle = 0;
+    m_device = nullptr;
+    m_allocator = nullptr;
+}
+
+UINT BufferPool::sizeClassFor(UINT64 size)
+{
+    if (size <= MIN_SIZE)
+        return 0;
+    return bitScanReverse64(size - 1) + 1 - bitScanReverse64(MIN_SIZE);
+}
+
+ID3D12Resource *BufferPool::acquire(Res::Storage type, UINT64 size, D3D12_RESOURCE_FLAGS flags)
+{
+    if (!m_device)
+        return nullptr;
+
+    const UINT sizeClass = size <= BUFFER_POOL_MAX_SIZE ? sizeClassFor(size) : UNPOOLED;
+    const Key key = { type, sizeClass, flags };
+    const UINT64 bufferSize = sizeClass == UNPOOLED ? size : MIN_SIZE << sizeClass;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_freeLists.find(key);
+        if (it != m_freeLists.end() && !it->second.empty()) {
+            ID3D12Resource *buffer = it->second.back();
+            it->second.pop_back();
+            ++m_stats.hits;
+            m_stats.bytesIdle -= bufferSize;
+            m_stats.bytesInUse += bufferSize;
+            return buffer;
+        }
+        ++m_stats.misses;
+    }
+
+    // the driver round trip happens without holding the lock
+    ID3D12Resource *buffer = Res::createBuffer(m_device, type, bufferSize, flags, m_allocator);
+    if (!buffer)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers[buffer] = { key, bufferSize };
+    ++m_stats.buffersCreated;
+    m_stats.bytesInUse += bufferSize;
+    return buffer;
+}
+
+void BufferPool::release(ID3D12Resource *buffer, UINT64 fenceValue)
+{
+    if (!buffer)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_buffers.find(buffer);
+    if (it == m_buffers.end()) {
+        log("Buffer %p released to a pool it does not belong to", buffer);
+        return;
+    }
+    m_stats.bytesInUse -= it->second.size;
+    m_stats.bytesPending += it->second.size;
+    m_deferredReleases.push_back({ buffer, fenceValue });
+}
+
+void BufferPool::reclaim(UINT64 completedFenceValue)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t kept = 0;
+    for (const DeferredRelease &r : m_deferredReleases) {
+        if (r.fenceValue > completedFenceValue) {
+            m_deferredReleases[kept++] = r;
+            continue;
+        }
+        const Buffer &b(m_buffers[r.buffer]);
+        m_stats.bytesPending -= b.size;
+        if (b.key.sizeClass == UNPOOLED || m_stats.bytesIdle + b.size > BUFFER_POOL_MAX_IDLE_SIZE) {
+            destroy(r.buffer);
+        } else {
+            m_freeLists[b.key].push_back(r.buffer);
+            m_stats.bytesIdle += b.size;
+        }
+    }
+    m_deferredReleases.resize(kept);
+}
+
+void BufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &freeList : m_freeLists) {
+        for (ID3D12Resource *buffer : freeList.second)
+            destroy(buffer);
+    }
+    m_freeLists.clear();
+    m_stats.bytesIdle = 0;
+}
+
+void BufferPool::destroy(ID3D12Resource *buffer)
+{
+    Res::releaseResource(buffer, m_allocator);
+    m_buffers.erase(buffer);
+    ++m_stats.buffersReleased;
+}
+
+BufferPool::Stats BufferPool::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void BufferPool::logStats()
+{
+    const Stats s = stats();
+    const UINT64 requests = s.hits + s.misses;
+    log("Buffer pool: hit rate %.1f%% (%llu of %llu), %llu buffers created %llu released, in use %llu KB pending %llu KB idle %llu KB",
+        requests ? 100.0 * double(s.hits) / double(requests) : 0.0, s.hits, requests,
+        s.buffersCreated, s.buffersReleased, s.bytesInUse / 1024, s.bytesPending / 1024, s.bytesIdle / 1024);
+}
@@ -0,0 +1,81 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include "common.h"
+#include "res.h"
+
+// Recycles buffers instead of creating and releasing them through
+// Res::createBuffer each time. Sizes are rounded up to power of two classes
+// starting from the 64 KB placement alignment, which is what a buffer takes
+// anyway. Released buffers wait for their fence, then go to a free list keyed
+// by (Storage, size class, flags) that acquire() takes from first. Buffers
+// above BUFFER_POOL_MAX_SIZE, or beyond BUFFER_POOL_MAX_IDLE_SIZE of idle
+// memory, are released for real instead. Thread-safe.
+struct BufferPool
+{
+    struct Stats {
+        UINT64 hits;
+        UINT64 misses;
+        UINT64 bytesInUse;
+        UINT64 bytesPending; // released but the GPU may still use them
+        UINT64 bytesIdle; // in the free lists
+        UINT64 buffersCreated;
+        UINT64 buffersReleased;
+    };
+
+    bool initialize(ID3D12Device *dev, ResHeapAllocator *allocator = nullptr);
+    void releaseResources();
+    bool isInitialized() const { return m_device != nullptr; }
+
+    // The buffer may be larger than size. It must be given back in its initial
+    // state, f.ex. COMMON for Storage::Device.
+    ID3D12Resource *acquire(Res::Storage type, UINT64 size, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+    // The buffer can be handed out again by the first reclaim() that sees the
+    // fence at or past fenceValue.
+    void release(ID3D12Resource *buffer, UINT64 fenceValue);
+    void reclaim(UINT64 completedFenceValue);
+    // Releases all idle buffers.
+    void trim();
+
+    Stats stats();
+    void logStats();
+
+    static const UINT64 MIN_SIZE = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    static const UINT UNPOOLED = ~0U;
+
+    struct Key {
+        Res::Storage type;
+        UINT sizeClass; // MIN_SIZE << sizeClass bytes, or UNPOOLED
+        D3D12_RESOURCE_FLAGS flags;
+        bool operator<(const Key &other) const
+        {
+            if (type != other.type)
+                return type < other.type;
+            if (sizeClass != other.sizeClass)
+                return sizeClass < other.sizeClass;
+            return flags < other.flags;
+        }
+    };
+    struct Buffer {
+        Key key;
+        UINT64 size;
+    };
+    struct DeferredRelease {
+        ID3D12Resource *buffer;
+        UINT64 fenceValue;
+    };
+
+    ID3D12Device *m_device = nullptr;
+    ResHeapAllocator *m_allocator = nullptr;
+    std::mutex m_mutex;
+    std::map<Key, std::vector<ID3D12Resource *>> m_freeLists;
+    std::map<ID3D12Resource *, Buffer> m_buffers; // all, idle or not
+    std::vector<DeferredRelease> m_deferredReleases;
+    Stats m_stats = {};
+
+private:
+    static UINT sizeClassFor(UINT64 size);
+    void destroy(ID3D12Resource *buffer);
+};
+
+#endif
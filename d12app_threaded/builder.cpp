@@ -1,18 +1,18 @@
 #include "builder.h"
 #include "app.h"
+#include "buildgraph.h"
 
 Builder::Builder(Type type)
     : m_type(type),
       m_threadModel(g_app->threadModel())
 {
     if (m_threadModel == ThreadModel::Threaded)
-        m_msgEvent = CreateEvent(nullptr, false, false, nullptr);
+        m_msgEvent = new WaitEvent;
 }
 
 Builder::~Builder()
 {
-    if (m_threadModel == ThreadModel::Threaded)
-        CloseHandle(m_msgEvent);
+    delete m_msgEvent;
 }
 
 void Builder::start()
@@ -28,7 +28,17 @@ void Builder::finish()
 {
     if (!isStarted())
         return;
-    postEvent(Event::Finish);
+    if (m_threadModel == ThreadModel::JobSystem) {
+        // there is no thread to join, but a job may still be running
+        Latch done;
+        done.arm(1);
+        postEvent(Event::Finish, &done);
+        done.wait();
+        while (m_activeJobs.load())
+            std::this_thread::yield();
+    } else {
+        postEvent(Event::Finish);
+    }
     if (m_threadModel == ThreadModel::Threaded) {
         m_thread->join();
         delete m_thread;
@@ -37,48 +47,67 @@ void Builder::finish()
     m_started = false;
 }
 
-void Builder::postEvent(Event e, HANDLE waitEvent)
+void Builder::postEvent(Event e, Latch *doneLatch, BuildGraph *graph)
 {
+    const ThreadMessage msg = { e, doneLatch, graph, Timestamp() };
     if (m_threadModel == ThreadModel::Threaded) {
-        {
-            std::lock_guard<std::mutex> lock(m_msgMutex);
-            m_events.push_back(std::make_pair(e, waitEvent));
-        }
-        SetEvent(m_msgEvent);
+        m_mailbox.post(msg, m_msgEvent);
+    } else if (m_threadModel == ThreadModel::JobSystem) {
+        m_mailbox.post(msg);
+        // at most one job per builder is in flight, so events are still processed in order
+        if (!m_jobScheduled.exchange(true))
+            g_app->m_jobSystem.submit({ &Builder::runJob, this });
     } else {
-        const ThreadMessage msg = std::make_pair(e, nullptr);
         invokeProcessEvent(msg);
+        completeMessage(msg);
     }
 }
 
-ID3D12CommandList *Builder::commandList() const
+bool Builder::hasCopyDependency() const
+{
+    for (const Builder *b : m_dependencies) {
+        if (b->type() == Type::CopyCommandList)
+            return true;
+    }
+    return false;
+}
+
+bool Builder::uploadToBuffer(ID3D12Resource *dst, UINT64 dstOffset, const void *data, UINT64 size)
+{
+    return g_app->m_uploadRing.uploadToBuffer(m_drawCmdList, dst, dstOffset, data, size);
+}
+
+bool Builder::readbackBuffer(ID3D12Resource *src, UINT64 srcOffset, UINT64 size, ReadbackRing::Callback callback)
+{
+    return g_app->m_readbackRing.readbackBuffer(m_drawCmdList, src, srcOffset, size, callback);
+}
+
+ID3D12CommandList *Builder::commandList(UINT frameSlot) const
 {
-    if (m_type == Type::GraphicsCommandList)
-        return m_drawCmdList;
+    if (hasCommandList())
+        return m_drawCmdLists[frameSlot];
 
     return nullptr;
 }
 
 bool Builder::initializeBaseResources()
 {
-    if (m_type == Type::GraphicsCommandList) {
+    if (hasCommandList()) {
+        const D3D12_COMMAND_LIST_TYPE listType = m_type == Type::CopyCommandList
+            ? D3D12_COMMAND_LIST_TYPE_COPY : D3D12_COMMAND_LIST_TYPE_DIRECT;
         for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
-            HRESULT hr = g_app->m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_ID3D12CommandAllocator,
-                reinterpret_cast<void **>(&m_cmdAllocator[i]));
-            if (FAILED(hr)) {
-                logHr("Failed to create command allocator", hr);
+            m_cmdAllocator[i] = g_app->m_backend->createCommandAllocator(listType);
+            if (!m_cmdAllocator[i])
                 return false;
-            }
         }
 
-        HRESULT hr = g_app->m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-            m_cmdAllocator[0], nullptr, IID_ID3D12GraphicsCommandList,
-            reinterpret_cast<void **>(&m_drawCmdList));
-        if (FAILED(hr)) {
-            logHr("Failed to create graphics command list", hr);
-            return false;
+        // one list per slot too, since with pipelined building the next slot is
+        // recorded before the previous one has been submitted
+        for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+            m_drawCmdLists[i] = g_app->m_backend->createCommandList(m_cmdAllocator[i], listType);
+            if (!m_drawCmdLists[i])
+                return false;
         }
-        m_drawCmdList->Close();
     }
 
     return true;
@@ -86,15 +115,19 @@ bool Builder::initializeBaseResources()
 
 void Builder::releaseBaseResources()
 {
-    if (m_type == Type::GraphicsCommandList) {
-        if (m_drawCmdList) {
-            m_drawCmdList->Release();
-            m_drawCmdList = nullptr;
+    if (hasCommandList()) {
+        m_drawCmdList = nullptr;
+        m_validSlots = 0;
+        for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+            if (m_drawCmdLists[i]) {
+                g_app->m_backend->releaseCommandList(m_drawCmdLists[i]);
+                m_drawCmdLists[i] = nullptr;
+            }
         }
 
         for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
             if (m_cmdAllocator[i]) {
-                m_cmdAllocator[i]->Release();
+                g_app->m_backend->releaseCommandAllocator(m_cmdAllocator[i]);
                 m_cmdAllocator[i] = nullptr;
             }
         }
@@ -104,26 +137,61 @@ void Builder::releaseBaseResources()
 void Builder::run()
 {
     assert(m_threadModel == ThreadModel::Threaded);
+    Trace::setThreadName("Builder thread");
     for (; ;) {
-        WaitForSingleObject(m_msgEvent, INFINITE);
-
-        m_msgMutex.lock();
-        std::vector<ThreadMessage> events = std::move(m_events);
-        m_msgMutex.unlock();
+        ThreadMessage e;
+        m_mailbox.take(&e, m_msgEvent);
+        if (e.event == Event::Finish) {
+            // the thread goes away, so does its descriptor cache
+            g_app->m_descHeapMgr.flushThreadCache();
+            return;
+        }
+        invokeProcessEvent(e);
+        completeMessage(e);
+    }
+}
 
-        for (const ThreadMessage &e : events) {
-            if (e.first == Event::Finish)
-                return;
-            invokeProcessEvent(e);
-            if (e.second)
-                SetEvent(e.second);
+void Builder::runJob(void *data)
+{
+    Builder *b = static_cast<Builder *>(data);
+    assert(b->m_threadModel == ThreadModel::JobSystem);
+    b->m_activeJobs.fetch_add(1);
+    for (; ;) {
+        ThreadMessage e;
+        while (b->m_mailbox.tryTake(&e)) {
+            if (e.event != Event::Finish)
+                b->invokeProcessEvent(e);
+            b->completeMessage(e);
         }
+        b->m_jobScheduled.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // a post that raced with the store above either sees false and submits
+        // a new job, or its message is visible here
+        if (b->m_mailbox.isEmpty() || b->m_jobScheduled.exchange(true))
+            break;
     }
+    b->m_activeJobs.fetch_sub(1); // b may be deleted after this
+}
+
+const char *Builder::name() const
+{
+    // not known in the constructor, racing first calls store the same pointer
+    const char *name = m_name.load(std::memory_order_relaxed);
+    if (!name) {
+        name = typeName(typeid(*this));
+        m_name.store(name, std::memory_order_relaxed);
+    }
+    return name;
 }
 
 void Builder::invokeProcessEvent(const ThreadMessage &e)
 {
-    if (e.first == Event::Build) {
+    const Timestamp startTime;
+    const INT64 traceStart = ENABLE_TRACE ? Trace::now() : 0;
+    if (ENABLE_BUILD_STATS && e.event == Event::Build)
+        m_queueWait.record(startTime.elapsedNsSince(e.postTime));
+
+    if (e.event == Event::Build) {
         if (!m_baseResReady) {
             if (!initializeBaseResources()) {
                 releaseBaseResources();
@@ -131,18 +199,35 @@ void Builder::invokeProcessEvent(const ThreadMessage &e)
             }
             m_baseResReady = true;
         }
-        if (m_type == Type::GraphicsCommandList) {
-            m_cmdAllocator[g_app->m_currentFrameSlot]->Reset();
-            m_drawCmdList->Reset(m_cmdAllocator[g_app->m_currentFrameSlot], nullptr);
+        if (hasCommandList()) {
+            const UINT slot = g_app->m_buildFrameSlot;
+            m_drawCmdList = m_drawCmdLists[slot];
+            g_app->m_backend->resetCommandAllocator(m_cmdAllocator[slot]);
+            g_app->m_backend->resetCommandList(m_drawCmdList, m_cmdAllocator[slot]);
         }
     }
-    processEvent(e.first);
-    if (e.first == Event::ReleaseResources) {
+    processEvent(e.event);
+    if (e.event == Event::ReleaseResources) {
         releaseBaseResources();
         m_baseResReady = false;
-    } else if (e.first == Event::Build && m_type == Type::GraphicsCommandList) {
-        m_drawCmdList->Close();
+    } else if (e.event == Event::Build && hasCommandList()) {
+        g_app->m_backend->closeCommandList(m_drawCmdList);
+        if (m_reuseCommandLists)
+            m_validSlots |= 1U << g_app->m_buildFrameSlot;
     }
+
+    if (ENABLE_BUILD_STATS && e.event == Event::Build)
+        m_buildTime.record(startTime.elapsedNs());
+    if (ENABLE_TRACE && e.event == Event::Build)
+        Trace::record(name(), traceStart, Trace::now());
+}
+
+void Builder::completeMessage(const ThreadMessage &e)
+{
+    if (e.graph)
+        e.graph->complete(this);
+    if (e.doneLatch)
+        e.doneLatch->countDown();
 }
 
 void ResourceBuilder::processEvent(Event e)
@@ -2,16 +2,29 @@
 #define BUILDER_H
 
 #include "common.h"
+#include "sync.h"
+#include "timestamp.h"
+#include "histogram.h"
+#include "trace.h"
+#include "readbackring.h"
+
+struct BuildGraph;
 
 struct Builder
 {
     enum class ThreadModel {
-        Threaded,
+        Threaded, // one thread per builder
+        JobSystem, // builders are tasks on the App's worker pool
         NonThreaded
     };
     enum class Type {
         NoCommandList,
-        GraphicsCommandList
+        GraphicsCommandList,
+        // Executed on the copy queue. Direct queue lists of builders that
+        // depend on it (addDependency) wait for it on the GPU, others do not,
+        // so they must not touch what it writes. Resources it writes start
+        // and end up in the COMMON state.
+        CopyCommandList
     };
     enum class Event {
         Finish,
@@ -23,11 +36,49 @@ struct Builder
     virtual ~Builder();
 
     Type type() const { return m_type; }
+    bool hasCommandList() const { return m_type != Type::NoCommandList; }
     ThreadModel threadModel() const { return m_threadModel; }
     bool isStarted() const { return m_started; }
-    void postEvent(Event e, HANDLE waitEvent = nullptr);
+    void postEvent(Event e, Latch *doneLatch = nullptr, BuildGraph *graph = nullptr);
+
+    // Explicit dependencies let the builder start as soon as these are done,
+    // instead of waiting for the whole previous stage of the BuilderTable.
+    // Dependencies not present in a given table are treated as satisfied.
+    void addDependency(Builder *b) { m_dependencies.push_back(b); }
+    const BuilderList &dependencies() const { return m_dependencies; }
+    bool hasCopyDependency() const;
+
+    // Build event statistics, recorded when ENABLE_BUILD_STATS is set.
+    // The queue wait is the time from postEvent until the builder starts on it.
+    const Histogram &buildTimeStats() const { return m_buildTime; }
+    const Histogram &queueWaitStats() const { return m_queueWait; }
+    void resetStats() { m_buildTime.reset(); m_queueWait.reset(); }
+    // The type name, for the stats log and the trace.
+    const char *name() const;
+
+    ID3D12CommandList *commandList(UINT frameSlot) const;
 
-    ID3D12CommandList *commandList() const;
+    // For Build: copies the data through the App's upload ring into dst,
+    // which must be in the COPY_DEST state, recording the copy on the list
+    // being built. Not for builders that reuse their command lists, the ring
+    // space is only valid for one frame.
+    bool uploadToBuffer(ID3D12Resource *dst, UINT64 dstOffset, const void *data, UINT64 size);
+    // For Build: copies from src, which must be in the COPY_SOURCE state, into
+    // the App's readback ring on the list being built. The callback runs on a
+    // job worker once the frame is done on the GPU. Not for builders that
+    // reuse their command lists either.
+    bool readbackBuffer(ID3D12Resource *src, UINT64 srcOffset, UINT64 size, ReadbackRing::Callback callback);
+
+    // Opt-in command list reuse for builders whose output does not change from
+    // frame to frame: each slot's list is recorded once, after that the builder
+    // is not invoked for Build and its list is simply submitted again, until
+    // markDirty(). Change only while the builder is idle, f.ex. from the frame
+    // func. The App marks every builder dirty on resize.
+    void setReuseCommandLists(bool enable) { m_reuseCommandLists = enable; markDirty(); }
+    bool reusesCommandLists() const { return m_reuseCommandLists; }
+    void markDirty() { m_validSlots = 0; }
+    bool canReuseCommandList(UINT frameSlot) const { return m_reuseCommandLists && (m_validSlots & (1U << frameSlot)); }
+    bool skipsEvent(Event e, UINT frameSlot) const { return e == Event::Build && canReuseCommandList(frameSlot); }
 
 protected:
     virtual void processEvent(Event e) = 0;
@@ -35,20 +86,43 @@ protected:
     Type m_type;
     ThreadModel m_threadModel;
     bool m_started = false;
-    HANDLE m_msgEvent;
-    std::mutex m_msgMutex;
+    WaitEvent *m_msgEvent = nullptr;
     std::thread *m_thread = nullptr;
-    using ThreadMessage = std::pair<Event, HANDLE>;
-    std::vector<ThreadMessage> m_events;
+    struct ThreadMessage {
+        Event event;
+        Latch *doneLatch;
+        BuildGraph *graph;
+        Timestamp postTime;
+    };
+    Mailbox<ThreadMessage, 16> m_mailbox;
+    std::atomic<bool> m_jobScheduled { false };
+    std::atomic<int> m_activeJobs { 0 };
     bool m_baseResReady = false;
     ID3D12CommandAllocator *m_cmdAllocator[FRAMES_IN_FLIGHT] = {};
-    ID3D12GraphicsCommandList *m_drawCmdList = nullptr;
+    ID3D12GraphicsCommandList *m_drawCmdLists[FRAMES_IN_FLIGHT] = {};
+    ID3D12GraphicsCommandList *m_drawCmdList = nullptr; // the one for the slot being built
+    bool m_reuseCommandLists = false;
+    UINT m_validSlots = 0; // bit per frame slot with a reusable list
+    BuilderList m_dependencies;
+    Histogram m_buildTime;
+    Histogram m_queueWait;
+    mutable std::atomic<const char *> m_name { nullptr }; // cached typeName()
 
 private:
     void start();
     void finish();
     void run();
+    static void runJob(void *data);
     void invokeProcessEvent(const ThreadMessage &e);
+    void completeMessage(const ThreadMessage &e);
+
+    // BuildGraph state, only touched while a graph dispatch is running
+    UINT64 m_graphEpoch = 0;
+    std::atomic<int> m_pendingDependencies { 0 };
+    std::atomic<UINT64> m_doneEpoch { 0 };
+    BuilderList m_dependents;
+
+    friend struct BuildGraph;
     bool initializeBaseResources();
     void releaseBaseResources();
     friend struct App;
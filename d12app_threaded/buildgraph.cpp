@@ -0,0 +1,87 @@
+#include "buildgraph.h"
+#include "app.h"
+
+bool BuildGraph::hasExplicitDependencies(const BuilderTable &bldTab)
+{
+    for (const BuilderList &bldList : bldTab) {
+        for (Builder *b : bldList) {
+            if (!b->m_dependencies.empty())
+                return true;
+        }
+    }
+    return false;
+}
+
+void BuildGraph::dispatch(Builder::Event e, const BuilderTable &bldTab, Latch *doneLatch)
+{
+    m_event = e;
+    m_doneLatch = doneLatch;
+    m_epoch += 1;
+
+    // Builders reusing their command list are done up front and count as
+    // satisfied dependencies, the same as builders not in the table.
+    const UINT frameSlot = g_app->m_buildFrameSlot;
+    int builderCount = 0;
+    for (const BuilderList &bldList : bldTab) {
+        for (Builder *b : bldList) {
+            b->m_dependents.clear();
+            if (b->skipsEvent(e, frameSlot)) {
+                b->m_doneEpoch.store(m_epoch, std::memory_order_relaxed);
+                continue;
+            }
+            b->m_graphEpoch = m_epoch;
+            ++builderCount;
+        }
+    }
+
+    m_roots.clear();
+    m_prevStage.clear();
+    for (const BuilderList &bldList : bldTab) {
+        m_stage.clear();
+        for (Builder *b : bldList) {
+            if (b->m_graphEpoch != m_epoch)
+                continue;
+            m_stage.push_back(b);
+            int pending = 0;
+            if (b->m_dependencies.empty()) {
+                for (Builder *dep : m_prevStage)
+                    dep->m_dependents.push_back(b);
+                pending = int(m_prevStage.size());
+            } else {
+                for (Builder *dep : b->m_dependencies) {
+                    if (dep->m_graphEpoch == m_epoch) {
+                        dep->m_dependents.push_back(b);
+                        ++pending;
+                    }
+                }
+            }
+            b->m_pendingDependencies.store(pending, std::memory_order_relaxed);
+            if (!pending)
+                m_roots.push_back(b);
+        }
+        if (!m_stage.empty())
+            m_prevStage.swap(m_stage);
+    }
+
+    if (m_doneLatch)
+        m_doneLatch->arm(builderCount);
+
+    // roots are collected up front since completions start arriving immediately
+    for (Builder *b : m_roots)
+        b->postEvent(e, m_doneLatch, this);
+}
+
+void BuildGraph::complete(Builder *b)
+{
+    // done before any dependent can start, so whoever sees a builder done
+    // also sees all its dependencies done
+    b->m_doneEpoch.store(m_epoch, std::memory_order_release);
+
+    for (Builder *dependent : b->m_dependents) {
+        if (dependent->m_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            dependent->postEvent(m_event, m_doneLatch, this);
+    }
+
+    if (m_progressEvent)
+        m_progressEvent->set();
+}
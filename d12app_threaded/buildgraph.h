@@ -0,0 +1,32 @@
+#ifndef BUILDGRAPH_H
+#define BUILDGRAPH_H
+
+#include "builder.h"
+
+// Dispatches the builders of a BuilderTable as soon as their inputs are done.
+// Builders with explicit dependencies wait only for those, the others keep the
+// stage semantics and depend on every builder of the previous non-empty stage.
+// The dependencies must be acyclic. For Build, builders that can reuse their
+// command list for the slot are not invoked at all.
+struct BuildGraph
+{
+    static bool hasExplicitDependencies(const BuilderTable &bldTab);
+
+    void dispatch(Builder::Event e, const BuilderTable &bldTab, Latch *doneLatch);
+    void complete(Builder *b);
+
+    // Signaled after each builder completes. Change only while no dispatch is running.
+    void setProgressEvent(WaitEvent *event) { m_progressEvent = event; }
+    bool isDone(const Builder *b) const { return b->m_doneEpoch.load(std::memory_order_acquire) == m_epoch; }
+
+private:
+    Builder::Event m_event = Builder::Event::Build;
+    Latch *m_doneLatch = nullptr;
+    UINT64 m_epoch = 0;
+    WaitEvent *m_progressEvent = nullptr;
+    BuilderList m_roots;
+    BuilderList m_stage;
+    BuilderList m_prevStage;
+};
+
+#endif
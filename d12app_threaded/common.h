@@ -1,27 +1,27 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#include "platform.h"
+
+#ifdef _WIN32
 #include <tchar.h>
 #include <comdef.h>
 
 #include <dxgi1_4.h>
 #include <d3d12.h>
-
-#include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdint.h>
-#include <assert.h>
-#include <vector>
-#include <functional>
-#include <algorithm>
-#include <chrono>
-#include <thread>
-#include <mutex>
+#else
+#include "d3d12headless.h"
+#endif
 
 const bool MULTITHREADED = true;
+const bool USE_JOB_SYSTEM = true; // builders run as tasks on a fixed worker pool instead of one thread each
+const bool PIPELINED_FRAME_BUILD = false; // build frame N+1 while frame N is submitted and presented
+const bool ENABLE_BUILD_STATS = false; // per-builder build and queue wait histograms
+const bool ENABLE_DESC_HEAP_STATS = true; // DescHeapMgr lock wait and hold histograms
+const bool ENABLE_TRACE = false; // per-thread timeline events, dumped as Chrome trace JSON
+const bool TRACK_DESCRIPTOR_LEAKS = false; // record where each descriptor range was allocated, report leftovers at releaseResources
+const UINT DESC_HEAP_STATS_LOG_INTERVAL = 0; // frames between DescHeapMgr::logStats() dumps, 0 = never
+const bool EARLY_SUBMIT = false; // submit finished builders while later ones are still recording (not when pipelined)
 const D3D_FEATURE_LEVEL FEATURE_LEVEL = D3D_FEATURE_LEVEL_11_0;
 const UINT DEFAULT_WIDTH = 1280;
 const UINT DEFAULT_HEIGHT = 720;
@@ -31,8 +31,14 @@ const DXGI_FORMAT SWAPCHAIN_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
 const bool ENABLE_DEBUG_LAYER = true;
 const int ADAPTER_INDEX = -1;
 const UINT PRESENT_SYNC_INTERVAL = 1;
+const UINT DESCRIPTOR_RING_SIZE = 16384; // shader-visible CBV_SRV_UAV descriptors for per-frame tables
+const UINT64 UPLOAD_RING_SIZE = 16 * 1024 * 1024; // persistently mapped upload buffer for per-frame data
+const UINT64 READBACK_RING_SIZE = 4 * 1024 * 1024; // persistently mapped readback buffer for GPU results, 0 = none
+const UINT64 RESOURCE_HEAP_SIZE = 64 * 1024 * 1024; // ID3D12Heap size for placed resources, 0 = committed resources only
+const UINT64 BUFFER_POOL_MAX_SIZE = 16 * 1024 * 1024; // larger BufferPool buffers are not recycled
+const UINT64 BUFFER_POOL_MAX_IDLE_SIZE = 64 * 1024 * 1024; // idle memory the BufferPool keeps at most
+const UINT BINDLESS_TABLE_SIZE = 65536; // CBV_SRV_UAV descriptors addressable by index from shaders, 0 = no bindless table
 
-void log(const char *fmt, ...);
 void logHr(const char *msg, HRESULT hr);
 
 template<typename Int>
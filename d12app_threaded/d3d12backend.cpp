@@ -0,0 +1,375 @@
+#include "d3d12backend.h"
+
+D3D12Backend::~D3D12Backend()
+{
+    releaseResources();
+}
+
+bool D3D12Backend::initialize(HWND hWnd, UINT width, UINT height)
+{
+    HRESULT hr = CreateDXGIFactory2(0, IID_IDXGIFactory2, reinterpret_cast<void **>(&m_dxgiFactory));
+    if (FAILED(hr)) {
+        logHr("Failed to create DXGI factory", hr);
+        return false;
+    }
+
+    IDXGIAdapter1 *adapterToUse = nullptr;
+    IDXGIAdapter1 *adapter;
+
+    for (int adapterIndex = 0; m_dxgiFactory->EnumAdapters1(UINT(adapterIndex), &adapter) != DXGI_ERROR_NOT_FOUND; ++adapterIndex) {
+        DXGI_ADAPTER_DESC1 desc;
+        adapter->GetDesc1(&desc);
+        log("Adapter %d: '%ls' (vendor 0x%X device 0x%X flags 0x%X)",
+            adapterIndex, desc.Description, desc.VendorId, desc.DeviceId, desc.Flags);
+        if (!adapterToUse && (ADAPTER_INDEX < 0 || ADAPTER_INDEX == adapterIndex)) {
+            adapterToUse = adapter;
+            log("  using this adapter");
+        } else {
+            adapter->Release();
+        }
+    }
+    if (!adapterToUse) {
+        log("No adapter");
+        return false;
+    }
+
+    if (FAILED(adapterToUse->QueryInterface(IID_IDXGIAdapter3, reinterpret_cast<void **>(&m_adapter)))) {
+        log("IDXGIAdapter3 not supported");
+        adapterToUse->Release();
+        return false;
+    }
+
+    if (ENABLE_DEBUG_LAYER) {
+        ID3D12Debug *debugController;
+        if (SUCCEEDED(D3D12GetDebugInterface(IID_ID3D12Debug, reinterpret_cast<void **>(&debugController)))) {
+            debugController->EnableDebugLayer();
+            log("D3D12 debug layer enabled");
+            debugController->Release();
+        }
+    }
+
+    hr = D3D12CreateDevice(adapterToUse, FEATURE_LEVEL, IID_ID3D12Device, reinterpret_cast<void **>(&m_device));
+    adapterToUse->Release();
+    if (FAILED(hr)) {
+        logHr("Failed to create D3D12 device", hr);
+        return false;
+    }
+
+    hr = m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &m_features, sizeof(m_features));
+    if (FAILED(hr)) {
+        logHr("Failed to query device options", hr);
+        return false;
+    }
+    hr = m_device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &m_archFeatures, sizeof(m_archFeatures));
+    if (FAILED(hr)) {
+        logHr("Failed to query arch features", hr);
+        return false;
+    }
+    log("Resource binding tier: %d Resource heap tier: %d Tile-based: %d UMA: %d CacheCoherentUMA: %d",
+        m_features.ResourceBindingTier, m_features.ResourceHeapTier,
+        m_archFeatures.TileBasedRenderer, m_archFeatures.UMA, m_archFeatures.CacheCoherentUMA);
+
+    logMemoryUsage();
+
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    hr = m_device->CreateCommandQueue(&queueDesc, IID_ID3D12CommandQueue, reinterpret_cast<void **>(&m_cmdQueue));
+    if (FAILED(hr)) {
+        logHr("Failed to create command queue", hr);
+        return false;
+    }
+
+    IDXGISwapChain1 *swapchain1;
+    DXGI_SWAP_CHAIN_DESC1 desc = {};
+    desc.Width = width;
+    desc.Height = height;
+    desc.Format = SWAPCHAIN_FORMAT;
+    desc.SampleDesc.Count = 1;
+    desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    desc.BufferCount = SWAPCHAIN_BUFFER_COUNT;
+    desc.Scaling = DXGI_SCALING_STRETCH;
+    desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    hr = m_dxgiFactory->CreateSwapChainForHwnd(m_cmdQueue, hWnd, &desc, nullptr, nullptr, &swapchain1);
+    if (FAILED(hr)) {
+        logHr("Failed to create swapchain", hr);
+        return false;
+    }
+
+    hr = swapchain1->QueryInterface(IID_IDXGISwapChain3, reinterpret_cast<void **>(&m_swapchain));
+    swapchain1->Release();
+    if (FAILED(hr)) {
+        logHr("IDXGISwapChain3 not supported", hr);
+        return false;
+    }
+
+    hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_ID3D12Fence, reinterpret_cast<void **>(&m_fence));
+    if (FAILED(hr)) {
+        logHr("Failed to create fence", hr);
+        return false;
+    }
+    m_fenceEvent = CreateEvent(nullptr, false, false, nullptr);
+
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    hr = m_device->CreateCommandQueue(&queueDesc, IID_ID3D12CommandQueue, reinterpret_cast<void **>(&m_copyQueue));
+    if (FAILED(hr)) {
+        logHr("Failed to create copy queue", hr);
+        return false;
+    }
+
+    hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_ID3D12Fence, reinterpret_cast<void **>(&m_copyFence));
+    if (FAILED(hr)) {
+        logHr("Failed to create copy fence", hr);
+        return false;
+    }
+    m_copyFenceEvent = CreateEvent(nullptr, false, false, nullptr);
+
+    m_dxgiFactory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER);
+
+    return true;
+}
+
+void D3D12Backend::releaseResources()
+{
+    if (m_fence) {
+        m_fence->Release();
+        m_fence = nullptr;
+    }
+
+    if (m_fenceEvent) {
+        CloseHandle(m_fenceEvent);
+        m_fenceEvent = nullptr;
+    }
+
+    if (m_copyFence) {
+        m_copyFence->Release();
+        m_copyFence = nullptr;
+    }
+
+    if (m_copyFenceEvent) {
+        CloseHandle(m_copyFenceEvent);
+        m_copyFenceEvent = nullptr;
+    }
+
+    if (m_copyQueue) {
+        m_copyQueue->Release();
+        m_copyQueue = nullptr;
+    }
+
+    if (m_swapchain) {
+        m_swapchain->Release();
+        m_swapchain = nullptr;
+    }
+
+    if (m_cmdQueue) {
+        m_cmdQueue->Release();
+        m_cmdQueue = nullptr;
+    }
+
+    if (m_device) {
+        m_device->Release();
+        m_device = nullptr;
+    }
+
+    if (m_adapter) {
+        m_adapter->Release();
+        m_adapter = nullptr;
+    }
+
+    if (m_dxgiFactory) {
+        m_dxgiFactory->Release();
+        m_dxgiFactory = nullptr;
+    }
+}
+
+void D3D12Backend::queryFeatures(D3D12_FEATURE_DATA_D3D12_OPTIONS *features, D3D12_FEATURE_DATA_ARCHITECTURE *archFeatures)
+{
+    *features = m_features;
+    *archFeatures = m_archFeatures;
+}
+
+void D3D12Backend::logMemoryUsage()
+{
+    if (!m_adapter)
+        return;
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO vidMemInfo;
+    if (SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &vidMemInfo))) {
+        log("Video memory local: Budget %llu KB CurrentUsage %llu KB AvailableForReservation %llu KB CurrentReservation %llu KB",
+            vidMemInfo.Budget / 1024, vidMemInfo.CurrentUsage / 1024,
+            vidMemInfo.AvailableForReservation / 1024, vidMemInfo.CurrentReservation / 1024);
+    }
+    if (SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &vidMemInfo))) {
+        log("Video memory non-local: Budget %llu KB CurrentUsage %llu KB AvailableForReservation %llu KB CurrentReservation %llu KB",
+            vidMemInfo.Budget / 1024, vidMemInfo.CurrentUsage / 1024,
+            vidMemInfo.AvailableForReservation / 1024, vidMemInfo.CurrentReservation / 1024);
+    }
+}
+
+UINT D3D12Backend::currentBackBufferIndex()
+{
+    return m_swapchain->GetCurrentBackBufferIndex();
+}
+
+bool D3D12Backend::getBackBuffer(UINT index, ID3D12Resource **buffer)
+{
+    HRESULT hr = m_swapchain->GetBuffer(index, IID_ID3D12Resource, reinterpret_cast<void **>(buffer));
+    if (FAILED(hr)) {
+        logHr("Failed to get swapchain buffer", hr);
+        return false;
+    }
+    return true;
+}
+
+HRESULT D3D12Backend::resizeSwapchain(UINT width, UINT height)
+{
+    return m_swapchain->ResizeBuffers(SWAPCHAIN_BUFFER_COUNT, width, height, SWAPCHAIN_FORMAT, 0);
+}
+
+HRESULT D3D12Backend::present(UINT syncInterval)
+{
+    return m_swapchain->Present(syncInterval, 0);
+}
+
+void D3D12Backend::executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists)
+{
+    m_cmdQueue->ExecuteCommandLists(count, cmdLists);
+}
+
+void D3D12Backend::signalFence(UINT64 value)
+{
+    m_cmdQueue->Signal(m_fence, value);
+}
+
+UINT64 D3D12Backend::completedFenceValue()
+{
+    return m_fence->GetCompletedValue();
+}
+
+void D3D12Backend::waitFence(UINT64 value)
+{
+    if (m_fence->GetCompletedValue() < value) {
+        m_fence->SetEventOnCompletion(value, m_fenceEvent);
+        WaitForSingleObject(m_fenceEvent, INFINITE);
+    }
+}
+
+void D3D12Backend::executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists)
+{
+    m_copyQueue->ExecuteCommandLists(count, cmdLists);
+}
+
+void D3D12Backend::signalCopyFence(UINT64 value)
+{
+    m_copyQueue->Signal(m_copyFence, value);
+}
+
+UINT64 D3D12Backend::completedCopyFenceValue()
+{
+    return m_copyFence->GetCompletedValue();
+}
+
+void D3D12Backend::waitCopyFence(UINT64 value)
+{
+    if (m_copyFence->GetCompletedValue() < value) {
+        m_copyFence->SetEventOnCompletion(value, m_copyFenceEvent);
+        WaitForSingleObject(m_copyFenceEvent, INFINITE);
+    }
+}
+
+void D3D12Backend::queueWaitCopyFence(UINT64 value)
+{
+    m_cmdQueue->Wait(m_copyFence, value);
+}
+
+ID3D12CommandAllocator *D3D12Backend::createCommandAllocator(D3D12_COMMAND_LIST_TYPE type)
+{
+    ID3D12CommandAllocator *allocator = nullptr;
+    HRESULT hr = m_device->CreateCommandAllocator(type, IID_ID3D12CommandAllocator,
+        reinterpret_cast<void **>(&allocator));
+    if (FAILED(hr)) {
+        logHr("Failed to create command allocator", hr);
+        return nullptr;
+    }
+    return allocator;
+}
+
+void D3D12Backend::releaseCommandAllocator(ID3D12CommandAllocator *allocator)
+{
+    allocator->Release();
+}
+
+void D3D12Backend::resetCommandAllocator(ID3D12CommandAllocator *allocator)
+{
+    allocator->Reset();
+}
+
+ID3D12GraphicsCommandList *D3D12Backend::createCommandList(ID3D12CommandAllocator *allocator, D3D12_COMMAND_LIST_TYPE type)
+{
+    ID3D12GraphicsCommandList *cmdList = nullptr;
+    HRESULT hr = m_device->CreateCommandList(0, type, allocator, nullptr,
+        IID_ID3D12GraphicsCommandList, reinterpret_cast<void **>(&cmdList));
+    if (FAILED(hr)) {
+        logHr("Failed to create command list", hr);
+        return nullptr;
+    }
+    cmdList->Close();
+    return cmdList;
+}
+
+void D3D12Backend::releaseCommandList(ID3D12GraphicsCommandList *cmdList)
+{
+    cmdList->Release();
+}
+
+void D3D12Backend::resetCommandList(ID3D12GraphicsCommandList *cmdList, ID3D12CommandAllocator *allocator)
+{
+    cmdList->Reset(allocator, nullptr);
+}
+
+void D3D12Backend::closeCommandList(ID3D12GraphicsCommandList *cmdList)
+{
+    cmdList->Close();
+}
+
+void D3D12Backend::resourceBarrier(ID3D12GraphicsCommandList *cmdList, const D3D12_RESOURCE_BARRIER &barrier)
+{
+    cmdList->ResourceBarrier(1, &barrier);
+}
+
+UINT D3D12Backend::descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+    return m_device->GetDescriptorHandleIncrementSize(type);
+}
+
+ID3D12DescriptorHeap *D3D12Backend::createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC &desc, D3D12_CPU_DESCRIPTOR_HANDLE *start,
+    D3D12_GPU_DESCRIPTOR_HANDLE *gpuStart)
+{
+    ID3D12DescriptorHeap *heap = nullptr;
+    HRESULT hr = m_device->CreateDescriptorHeap(&desc, IID_ID3D12DescriptorHeap, reinterpret_cast<void **>(&heap));
+    if (FAILED(hr)) {
+        logHr("Failed to create descriptor heap", hr);
+        return nullptr;
+    }
+    *start = heap->GetCPUDescriptorHandleForHeapStart();
+    if (gpuStart)
+        *gpuStart = (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) ? heap->GetGPUDescriptorHandleForHeapStart() : D3D12_GPU_DESCRIPTOR_HANDLE {};
+    return heap;
+}
+
+void D3D12Backend::releaseDescriptorHeap(ID3D12DescriptorHeap *heap)
+{
+    heap->Release();
+}
+
+void D3D12Backend::copyDescriptorsSimple(UINT n, D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+    D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+    m_device->CopyDescriptorsSimple(n, dst, src, type);
+}
+
+void D3D12Backend::copyDescriptors(UINT dstRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *dstStarts, const UINT *dstSizes,
+    UINT srcRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *srcStarts, const UINT *srcSizes,
+    D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+    m_device->CopyDescriptors(dstRangeCount, dstStarts, dstSizes, srcRangeCount, srcStarts, srcSizes, type);
+}
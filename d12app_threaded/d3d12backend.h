@@ -0,0 +1,67 @@
+#ifndef D3D12BACKEND_H
+#define D3D12BACKEND_H
+
+#include "gpubackend.h"
+
+struct D3D12Backend : public GpuBackend
+{
+    ~D3D12Backend();
+
+    bool initialize(HWND hWnd, UINT width, UINT height) override;
+    void releaseResources() override;
+    bool isInitialized() const override { return m_device != nullptr; }
+    ID3D12Device *device() const override { return m_device; }
+    void queryFeatures(D3D12_FEATURE_DATA_D3D12_OPTIONS *features, D3D12_FEATURE_DATA_ARCHITECTURE *archFeatures) override;
+    void logMemoryUsage() override;
+
+    UINT currentBackBufferIndex() override;
+    bool getBackBuffer(UINT index, ID3D12Resource **buffer) override;
+    HRESULT resizeSwapchain(UINT width, UINT height) override;
+    HRESULT present(UINT syncInterval) override;
+
+    void executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override;
+    void signalFence(UINT64 value) override;
+    UINT64 completedFenceValue() override;
+    void waitFence(UINT64 value) override;
+
+    void executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override;
+    void signalCopyFence(UINT64 value) override;
+    UINT64 completedCopyFenceValue() override;
+    void waitCopyFence(UINT64 value) override;
+    void queueWaitCopyFence(UINT64 value) override;
+
+    ID3D12CommandAllocator *createCommandAllocator(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) override;
+    void releaseCommandAllocator(ID3D12CommandAllocator *allocator) override;
+    void resetCommandAllocator(ID3D12CommandAllocator *allocator) override;
+    ID3D12GraphicsCommandList *createCommandList(ID3D12CommandAllocator *allocator,
+        D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) override;
+    void releaseCommandList(ID3D12GraphicsCommandList *cmdList) override;
+    void resetCommandList(ID3D12GraphicsCommandList *cmdList, ID3D12CommandAllocator *allocator) override;
+    void closeCommandList(ID3D12GraphicsCommandList *cmdList) override;
+    void resourceBarrier(ID3D12GraphicsCommandList *cmdList, const D3D12_RESOURCE_BARRIER &barrier) override;
+
+    UINT descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+    ID3D12DescriptorHeap *createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC &desc, D3D12_CPU_DESCRIPTOR_HANDLE *start,
+        D3D12_GPU_DESCRIPTOR_HANDLE *gpuStart = nullptr) override;
+    void releaseDescriptorHeap(ID3D12DescriptorHeap *heap) override;
+    void copyDescriptorsSimple(UINT n, D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+    void copyDescriptors(UINT dstRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *dstStarts, const UINT *dstSizes,
+        UINT srcRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *srcStarts, const UINT *srcSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+
+    IDXGIFactory3 *m_dxgiFactory = nullptr;
+    IDXGIAdapter3 *m_adapter = nullptr;
+    ID3D12Device *m_device = nullptr;
+    D3D12_FEATURE_DATA_D3D12_OPTIONS m_features = {};
+    D3D12_FEATURE_DATA_ARCHITECTURE m_archFeatures = {};
+    ID3D12CommandQueue *m_cmdQueue = nullptr;
+    IDXGISwapChain3 *m_swapchain = nullptr;
+    ID3D12Fence *m_fence = nullptr;
+    HANDLE m_fenceEvent = nullptr;
+    ID3D12CommandQueue *m_copyQueue = nullptr;
+    ID3D12Fence *m_copyFence = nullptr;
+    HANDLE m_copyFenceEvent = nullptr;
+};
+
+#endif
@@ -0,0 +1,416 @@
+#ifndef D3D12HEADLESS_H
+#define D3D12HEADLESS_H
+
+// The subset of the Windows, DXGI and D3D12 declarations the frame machinery
+// needs to compile without the Windows SDK, for NullBackend builds. There are
+// only declarations, nothing here can create a device, so code behind a null
+// device() (and D3D12Backend, which is not built) never calls into these.
+
+#include "platform.h"
+
+typedef int BOOL;
+typedef int INT;
+typedef float FLOAT;
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef unsigned long ULONG;
+typedef int32_t HRESULT; // long is 32 bits on Windows, error codes must stay negative
+typedef void *HANDLE;
+typedef const char *LPCSTR;
+struct HINSTANCE__;
+typedef HINSTANCE__ *HINSTANCE;
+struct HWND__;
+typedef HWND__ *HWND;
+struct IID { uint32_t data[4]; };
+typedef const IID &REFIID;
+struct RECT { INT left, top, right, bottom; };
+
+#define FAILED(hr) (HRESULT(hr) < 0)
+#define SUCCEEDED(hr) (HRESULT(hr) >= 0)
+#define S_OK HRESULT(0)
+#define E_NOTIMPL HRESULT(0x80004001L)
+#define E_FAIL HRESULT(0x80004005L)
+
+struct IUnknown
+{
+    virtual HRESULT QueryInterface(REFIID riid, void **object) = 0;
+    virtual ULONG AddRef() = 0;
+    virtual ULONG Release() = 0;
+};
+
+// DXGI
+
+enum DXGI_FORMAT {
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32G32B32_FLOAT = 6,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_D24_UNORM_S8_UINT = 45
+};
+
+struct DXGI_SAMPLE_DESC { UINT Count; UINT Quality; };
+
+#define DXGI_ERROR_DEVICE_REMOVED HRESULT(0x887A0005L)
+#define DXGI_ERROR_DEVICE_RESET HRESULT(0x887A0007L)
+
+// D3D12
+
+enum D3D_FEATURE_LEVEL { D3D_FEATURE_LEVEL_11_0 = 0xb000 };
+enum D3D_ROOT_SIGNATURE_VERSION { D3D_ROOT_SIGNATURE_VERSION_1 = 1 };
+
+typedef UINT64 D3D12_GPU_VIRTUAL_ADDRESS;
+struct D3D12_CPU_DESCRIPTOR_HANDLE { SIZE_T ptr; };
+struct D3D12_GPU_DESCRIPTOR_HANDLE { UINT64 ptr; };
+struct D3D12_RANGE { SIZE_T Begin; SIZE_T End; };
+
+#define D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT 65536
+#define D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT 4194304
+#define D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT 512
+#define D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT 256
+#define D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES 0xffffffff
+#define D3D12_DEFAULT_DEPTH_BIAS 0
+#define D3D12_DEFAULT_DEPTH_BIAS_CLAMP 0.0f
+#define D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS 0.0f
+
+enum D3D12_COMMAND_LIST_TYPE {
+    D3D12_COMMAND_LIST_TYPE_DIRECT = 0,
+    D3D12_COMMAND_LIST_TYPE_BUNDLE = 1,
+    D3D12_COMMAND_LIST_TYPE_COMPUTE = 2,
+    D3D12_COMMAND_LIST_TYPE_COPY = 3
+};
+
+enum D3D12_DESCRIPTOR_HEAP_TYPE {
+    D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV = 0,
+    D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+    D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+    D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+    D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES
+};
+enum D3D12_DESCRIPTOR_HEAP_FLAGS {
+    D3D12_DESCRIPTOR_HEAP_FLAG_NONE = 0,
+    D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE = 0x1
+};
+struct D3D12_DESCRIPTOR_HEAP_DESC {
+    D3D12_DESCRIPTOR_HEAP_TYPE Type;
+    UINT NumDescriptors;
+    D3D12_DESCRIPTOR_HEAP_FLAGS Flags;
+    UINT NodeMask;
+};
+
+enum D3D12_RESOURCE_BINDING_TIER {
+    D3D12_RESOURCE_BINDING_TIER_1 = 1,
+    D3D12_RESOURCE_BINDING_TIER_2 = 2,
+    D3D12_RESOURCE_BINDING_TIER_3 = 3
+};
+enum D3D12_RESOURCE_HEAP_TIER {
+    D3D12_RESOURCE_HEAP_TIER_1 = 1,
+    D3D12_RESOURCE_HEAP_TIER_2 = 2
+};
+enum D3D12_FEATURE {
+    D3D12_FEATURE_D3D12_OPTIONS = 0,
+    D3D12_FEATURE_ARCHITECTURE = 1,
+    D3D12_FEATURE_MULTISAMPLE_QUALITY_LEVELS = 4
+};
+struct D3D12_FEATURE_DATA_D3D12_OPTIONS {
+    D3D12_RESOURCE_BINDING_TIER ResourceBindingTier;
+    D3D12_RESOURCE_HEAP_TIER ResourceHeapTier;
+};
+struct D3D12_FEATURE_DATA_ARCHITECTURE {
+    UINT NodeIndex;
+    BOOL TileBasedRenderer;
+    BOOL UMA;
+    BOOL CacheCoherentUMA;
+};
+struct D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS {
+    DXGI_FORMAT Format;
+    UINT SampleCount;
+    UINT Flags;
+    UINT NumQualityLevels;
+};
+
+enum D3D12_HEAP_TYPE {
+    D3D12_HEAP_TYPE_DEFAULT = 1,
+    D3D12_HEAP_TYPE_UPLOAD = 2,
+    D3D12_HEAP_TYPE_READBACK = 3
+};
+enum D3D12_HEAP_FLAGS {
+    D3D12_HEAP_FLAG_NONE = 0,
+    D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES = 0,
+    D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS = 0xc0,
+    D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES = 0x44,
+    D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES = 0x84
+};
+struct D3D12_HEAP_PROPERTIES {
+    D3D12_HEAP_TYPE Type;
+    INT CPUPageProperty;
+    INT MemoryPoolPreference;
+    UINT CreationNodeMask;
+    UINT VisibleNodeMask;
+};
+struct D3D12_HEAP_DESC {
+    UINT64 SizeInBytes;
+    D3D12_HEAP_PROPERTIES Properties;
+    UINT64 Alignment;
+    D3D12_HEAP_FLAGS Flags;
+};
+
+enum D3D12_RESOURCE_STATES {
+    D3D12_RESOURCE_STATE_COMMON = 0,
+    D3D12_RESOURCE_STATE_RENDER_TARGET = 0x4,
+    D3D12_RESOURCE_STATE_DEPTH_WRITE = 0x10,
+    D3D12_RESOURCE_STATE_COPY_DEST = 0x400,
+    D3D12_RESOURCE_STATE_COPY_SOURCE = 0x800,
+    D3D12_RESOURCE_STATE_GENERIC_READ = 0xac3,
+    D3D12_RESOURCE_STATE_PRESENT = 0
+};
+enum D3D12_RESOURCE_DIMENSION {
+    D3D12_RESOURCE_DIMENSION_UNKNOWN = 0,
+    D3D12_RESOURCE_DIMENSION_BUFFER = 1,
+    D3D12_RESOURCE_DIMENSION_TEXTURE2D = 3
+};
+enum D3D12_TEXTURE_LAYOUT {
+    D3D12_TEXTURE_LAYOUT_UNKNOWN = 0,
+    D3D12_TEXTURE_LAYOUT_ROW_MAJOR = 1
+};
+enum D3D12_RESOURCE_FLAGS {
+    D3D12_RESOURCE_FLAG_NONE = 0,
+    D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET = 0x1,
+    D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL = 0x2,
+    D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS = 0x4
+};
+struct D3D12_RESOURCE_DESC {
+    D3D12_RESOURCE_DIMENSION Dimension;
+    UINT64 Alignment;
+    UINT64 Width;
+    UINT Height;
+    UINT16 DepthOrArraySize;
+    UINT16 MipLevels;
+    DXGI_FORMAT Format;
+    DXGI_SAMPLE_DESC SampleDesc;
+    D3D12_TEXTURE_LAYOUT Layout;
+    D3D12_RESOURCE_FLAGS Flags;
+};
+struct D3D12_RESOURCE_ALLOCATION_INFO {
+    UINT64 SizeInBytes;
+    UINT64 Alignment;
+};
+struct D3D12_DEPTH_STENCIL_VALUE {
+    FLOAT Depth;
+    UINT8 Stencil;
+};
+struct D3D12_CLEAR_VALUE {
+    DXGI_FORMAT Format;
+    union {
+        FLOAT Color[4];
+        D3D12_DEPTH_STENCIL_VALUE DepthStencil;
+    };
+};
+
+enum D3D12_RESOURCE_BARRIER_TYPE { D3D12_RESOURCE_BARRIER_TYPE_TRANSITION = 0 };
+enum D3D12_RESOURCE_BARRIER_FLAGS { D3D12_RESOURCE_BARRIER_FLAG_NONE = 0 };
+struct ID3D12Resource;
+struct D3D12_RESOURCE_TRANSITION_BARRIER {
+    ID3D12Resource *pResource;
+    UINT Subresource;
+    D3D12_RESOURCE_STATES StateBefore;
+    D3D12_RESOURCE_STATES StateAfter;
+};
+struct D3D12_RESOURCE_BARRIER {
+    D3D12_RESOURCE_BARRIER_TYPE Type;
+    D3D12_RESOURCE_BARRIER_FLAGS Flags;
+    union {
+        D3D12_RESOURCE_TRANSITION_BARRIER Transition;
+    };
+};
+
+// views, only ever passed through by pointer
+struct D3D12_RENDER_TARGET_VIEW_DESC;
+struct D3D12_SHADER_RESOURCE_VIEW_DESC;
+struct D3D12_UNORDERED_ACCESS_VIEW_DESC;
+struct D3D12_CONSTANT_BUFFER_VIEW_DESC {
+    D3D12_GPU_VIRTUAL_ADDRESS BufferLocation;
+    UINT SizeInBytes;
+};
+enum D3D12_DSV_DIMENSION {
+    D3D12_DSV_DIMENSION_TEXTURE2D = 3,
+    D3D12_DSV_DIMENSION_TEXTURE2DMS = 5
+};
+struct D3D12_DEPTH_STENCIL_VIEW_DESC {
+    DXGI_FORMAT Format;
+    D3D12_DSV_DIMENSION ViewDimension;
+    UINT Flags;
+    struct { UINT MipSlice; } Texture2D;
+};
+
+// root signatures and pipeline states
+enum D3D12_SHADER_VISIBILITY { D3D12_SHADER_VISIBILITY_ALL = 0 };
+enum D3D12_DESCRIPTOR_RANGE_TYPE {
+    D3D12_DESCRIPTOR_RANGE_TYPE_SRV = 0,
+    D3D12_DESCRIPTOR_RANGE_TYPE_UAV = 1,
+    D3D12_DESCRIPTOR_RANGE_TYPE_CBV = 2
+};
+struct D3D12_DESCRIPTOR_RANGE {
+    D3D12_DESCRIPTOR_RANGE_TYPE RangeType;
+    UINT NumDescriptors;
+    UINT BaseShaderRegister;
+    UINT RegisterSpace;
+    UINT OffsetInDescriptorsFromTableStart;
+};
+struct D3D12_ROOT_DESCRIPTOR_TABLE {
+    UINT NumDescriptorRanges;
+    const D3D12_DESCRIPTOR_RANGE *pDescriptorRanges;
+};
+struct D3D12_ROOT_DESCRIPTOR {
+    UINT ShaderRegister;
+    UINT RegisterSpace;
+};
+enum D3D12_ROOT_PARAMETER_TYPE {
+    D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE = 0,
+    D3D12_ROOT_PARAMETER_TYPE_CBV = 2
+};
+struct D3D12_ROOT_PARAMETER {
+    D3D12_ROOT_PARAMETER_TYPE ParameterType;
+    union {
+        D3D12_ROOT_DESCRIPTOR_TABLE DescriptorTable;
+        D3D12_ROOT_DESCRIPTOR Descriptor;
+    };
+    D3D12_SHADER_VISIBILITY ShaderVisibility;
+};
+struct D3D12_STATIC_SAMPLER_DESC;
+enum D3D12_ROOT_SIGNATURE_FLAGS {
+    D3D12_ROOT_SIGNATURE_FLAG_NONE = 0,
+    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT = 0x1
+};
+struct D3D12_ROOT_SIGNATURE_DESC {
+    UINT NumParameters;
+    const D3D12_ROOT_PARAMETER *pParameters;
+    UINT NumStaticSamplers;
+    const D3D12_STATIC_SAMPLER_DESC *pStaticSamplers;
+    D3D12_ROOT_SIGNATURE_FLAGS Flags;
+};
+struct D3D12_SHADER_BYTECODE {
+    const void *pShaderBytecode;
+    SIZE_T BytecodeLength;
+};
+enum { D3D12_COLOR_WRITE_ENABLE_ALL = 0xf };
+struct D3D12_RENDER_TARGET_BLEND_DESC {
+    BOOL BlendEnable;
+    UINT8 RenderTargetWriteMask;
+};
+struct D3D12_BLEND_DESC {
+    BOOL AlphaToCoverageEnable;
+    BOOL IndependentBlendEnable;
+    D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+enum D3D12_FILL_MODE { D3D12_FILL_MODE_SOLID = 3 };
+enum D3D12_CULL_MODE { D3D12_CULL_MODE_NONE = 1 };
+struct D3D12_RASTERIZER_DESC {
+    D3D12_FILL_MODE FillMode;
+    D3D12_CULL_MODE CullMode;
+    BOOL FrontCounterClockwise;
+    INT DepthBias;
+    FLOAT DepthBiasClamp;
+    FLOAT SlopeScaledDepthBias;
+    BOOL DepthClipEnable;
+};
+enum D3D12_DEPTH_WRITE_MASK { D3D12_DEPTH_WRITE_MASK_ALL = 1 };
+enum D3D12_COMPARISON_FUNC { D3D12_COMPARISON_FUNC_LESS = 2 };
+struct D3D12_DEPTH_STENCIL_DESC {
+    BOOL DepthEnable;
+    D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+    D3D12_COMPARISON_FUNC DepthFunc;
+};
+enum D3D12_INPUT_CLASSIFICATION { D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0 };
+struct D3D12_INPUT_ELEMENT_DESC {
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    DXGI_FORMAT Format;
+    UINT InputSlot;
+    UINT AlignedByteOffset;
+    D3D12_INPUT_CLASSIFICATION InputSlotClass;
+    UINT InstanceDataStepRate;
+};
+struct D3D12_INPUT_LAYOUT_DESC {
+    const D3D12_INPUT_ELEMENT_DESC *pInputElementDescs;
+    UINT NumElements;
+};
+enum D3D12_PRIMITIVE_TOPOLOGY_TYPE { D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3 };
+struct ID3D12RootSignature;
+struct D3D12_GRAPHICS_PIPELINE_STATE_DESC {
+    ID3D12RootSignature *pRootSignature;
+    D3D12_SHADER_BYTECODE VS;
+    D3D12_SHADER_BYTECODE PS;
+    D3D12_BLEND_DESC BlendState;
+    UINT SampleMask;
+    D3D12_RASTERIZER_DESC RasterizerState;
+    D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+    D3D12_INPUT_LAYOUT_DESC InputLayout;
+    D3D12_PRIMITIVE_TOPOLOGY_TYPE PrimitiveTopologyType;
+    UINT NumRenderTargets;
+    DXGI_FORMAT RTVFormats[8];
+    DXGI_FORMAT DSVFormat;
+    DXGI_SAMPLE_DESC SampleDesc;
+};
+
+// interfaces
+
+struct ID3DBlob : IUnknown
+{
+    virtual void *GetBufferPointer() = 0;
+    virtual SIZE_T GetBufferSize() = 0;
+};
+struct ID3D12Pageable : IUnknown { };
+struct ID3D12Heap : ID3D12Pageable { };
+struct ID3D12Resource : ID3D12Pageable
+{
+    virtual HRESULT Map(UINT subresource, const D3D12_RANGE *readRange, void **data) = 0;
+    virtual void Unmap(UINT subresource, const D3D12_RANGE *writtenRange) = 0;
+    virtual D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() = 0;
+};
+struct ID3D12RootSignature : IUnknown { };
+struct ID3D12PipelineState : ID3D12Pageable { };
+struct ID3D12DescriptorHeap : ID3D12Pageable { };
+struct ID3D12CommandAllocator : ID3D12Pageable { };
+struct ID3D12CommandList : IUnknown { };
+struct ID3D12GraphicsCommandList : ID3D12CommandList
+{
+    virtual void CopyBufferRegion(ID3D12Resource *dst, UINT64 dstOffset, ID3D12Resource *src, UINT64 srcOffset, UINT64 numBytes) = 0;
+    virtual void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER *barriers) = 0;
+};
+struct ID3D12Device : IUnknown
+{
+    virtual HRESULT CheckFeatureSupport(D3D12_FEATURE feature, void *data, UINT dataSize) = 0;
+    virtual HRESULT CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC *desc, REFIID riid, void **pso) = 0;
+    virtual HRESULT CreateRootSignature(UINT nodeMask, const void *blob, SIZE_T blobSize, REFIID riid, void **rootSig) = 0;
+    virtual void CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC *desc, D3D12_CPU_DESCRIPTOR_HANDLE dst) = 0;
+    virtual void CreateShaderResourceView(ID3D12Resource *resource, const D3D12_SHADER_RESOURCE_VIEW_DESC *desc,
+        D3D12_CPU_DESCRIPTOR_HANDLE dst) = 0;
+    virtual void CreateUnorderedAccessView(ID3D12Resource *resource, ID3D12Resource *counter,
+        const D3D12_UNORDERED_ACCESS_VIEW_DESC *desc, D3D12_CPU_DESCRIPTOR_HANDLE dst) = 0;
+    virtual void CreateRenderTargetView(ID3D12Resource *resource, const D3D12_RENDER_TARGET_VIEW_DESC *desc,
+        D3D12_CPU_DESCRIPTOR_HANDLE dst) = 0;
+    virtual void CreateDepthStencilView(ID3D12Resource *resource, const D3D12_DEPTH_STENCIL_VIEW_DESC *desc,
+        D3D12_CPU_DESCRIPTOR_HANDLE dst) = 0;
+    virtual D3D12_RESOURCE_ALLOCATION_INFO GetResourceAllocationInfo(UINT visibleMask, UINT numDescs,
+        const D3D12_RESOURCE_DESC *descs) = 0;
+    virtual HRESULT CreateCommittedResource(const D3D12_HEAP_PROPERTIES *heapProps, D3D12_HEAP_FLAGS heapFlags,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue,
+        REFIID riid, void **resource) = 0;
+    virtual HRESULT CreateHeap(const D3D12_HEAP_DESC *desc, REFIID riid, void **heap) = 0;
+    virtual HRESULT CreatePlacedResource(ID3D12Heap *heap, UINT64 heapOffset, const D3D12_RESOURCE_DESC *desc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue, REFIID riid, void **resource) = 0;
+};
+
+const IID IID_ID3D12Heap = {};
+const IID IID_ID3D12PipelineState = {};
+const IID IID_ID3D12Resource = {};
+const IID IID_ID3D12RootSignature = {};
+
+inline HRESULT D3D12SerializeRootSignature(const D3D12_ROOT_SIGNATURE_DESC *, D3D_ROOT_SIGNATURE_VERSION, ID3DBlob **blob, ID3DBlob **errorBlob)
+{
+    *blob = nullptr;
+    if (errorBlob)
+        *errorBlob = nullptr;
+    return E_NOTIMPL;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "desccopy.h"
+
+DescCopyBatch::DescCopyBatch(GpuBackend *backend, D3D12_DESCRIPTOR_HEAP_TYPE type)
+    : m_backend(backend),
+      m_type(type),
+      m_handleSize(backend->descriptorHandleSize(type))
+{
+}
+
+void DescCopyBatch::add(D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src, UINT n)
+{
+    if (n < 1)
+        return;
+
+    if (!m_dstStarts.empty() && m_dstStarts.back().ptr + SIZE_T(m_dstSizes.back()) * m_handleSize == dst.ptr) {
+        m_dstSizes.back() += n;
+    } else {
+        m_dstStarts.push_back(dst);
+        m_dstSizes.push_back(n);
+    }
+
+    if (!m_srcStarts.empty() && m_srcStarts.back().ptr + SIZE_T(m_srcSizes.back()) * m_handleSize == src.ptr) {
+        m_srcSizes.back() += n;
+    } else {
+        m_srcStarts.push_back(src);
+        m_srcSizes.push_back(n);
+    }
+}
+
+void DescCopyBatch::flush()
+{
+    if (m_dstStarts.empty())
+        return;
+
+    if (m_dstStarts.size() == 1 && m_srcStarts.size() == 1)
+        m_backend->copyDescriptorsSimple(m_dstSizes[0], m_dstStarts[0], m_srcStarts[0], m_type);
+    else
+        m_backend->copyDescriptors(UINT(m_dstStarts.size()), m_dstStarts.data(), m_dstSizes.data(),
+            UINT(m_srcStarts.size()), m_srcStarts.data(), m_srcSizes.data(), m_type);
+
+    m_dstStarts.clear();
+    m_dstSizes.clear();
+    m_srcStarts.clear();
+    m_srcSizes.clear();
+}
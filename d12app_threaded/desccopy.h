@@ -0,0 +1,32 @@
+#ifndef DESCCOPY_H
+#define DESCCOPY_H
+
+#include "gpubackend.h"
+
+// Collects descriptor copies of one heap type and issues them as a single
+// CopyDescriptors. A piece whose destination or source continues where the
+// previous one ended extends that range instead of adding one. Not
+// thread-safe, each thread should have its own.
+struct DescCopyBatch
+{
+    DescCopyBatch(GpuBackend *backend, D3D12_DESCRIPTOR_HEAP_TYPE type);
+    ~DescCopyBatch() { flush(); }
+    DescCopyBatch(const DescCopyBatch &) = delete;
+    DescCopyBatch &operator=(const DescCopyBatch &) = delete;
+
+    void add(D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src, UINT n);
+    void flush();
+
+    UINT dstRangeCount() const { return UINT(m_dstStarts.size()); }
+    UINT srcRangeCount() const { return UINT(m_srcStarts.size()); }
+
+    GpuBackend *m_backend;
+    D3D12_DESCRIPTOR_HEAP_TYPE m_type;
+    UINT m_handleSize;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_dstStarts;
+    std::vector<UINT> m_dstSizes;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_srcStarts;
+    std::vector<UINT> m_srcSizes;
+};
+
+#endif
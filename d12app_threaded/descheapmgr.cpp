@@ -1,81 +1,340 @@
 #include "descheapmgr.h"
+#include "timestamp.h"
+
+static const UINT64 ALL_FREE = ~UINT64(0);
+
+// bits [first, first + count) of a word, count in 1..64
+static inline UINT64 wordMask(UINT first, UINT count)
+{
+    return (count == 64 ? ALL_FREE : ((UINT64(1) << count) - 1)) << first;
+}
+
+// bit i is set when bits i..i+n-1 of w are all set, n in 1..64
+static inline UINT64 runStarts(UINT64 w, UINT n)
+{
+    UINT len = 1;
+    while (len < n && w) {
+        const UINT shift = (std::min)(len, n - len);
+        w &= w >> shift;
+        len += shift;
+    }
+    return w;
+}
+
+bool DescHeapMgr::findFreeRun(const Heap &heap, UINT n, UINT *pos)
+{
+    const UINT wordCount = UINT(heap.freeMap.size());
+    UINT run = 0; // free bits at the top of the previous word(s)
+    UINT runStart = 0;
+    UINT w = 0;
+    while (w < wordCount) {
+        if (!(heap.summary[w / 64] & (UINT64(1) << (w % 64)))) {
+            // full word, jump to the next one with a free bit
+            run = 0;
+            UINT64 s = heap.summary[w / 64] & (ALL_FREE << (w % 64));
+            UINT sw = w / 64;
+            while (!s && ++sw < UINT(heap.summary.size()))
+                s = heap.summary[sw];
+            if (!s)
+                return false;
+            w = sw * 64 + bitScanForward64(s);
+            continue;
+        }
+
+        const UINT64 bits = heap.freeMap[w];
+        if (bits == ALL_FREE) {
+            if (!run)
+                runStart = w * 64;
+            run += 64;
+            if (run >= n) {
+                *pos = runStart;
+                return true;
+            }
+            ++w;
+            continue;
+        }
+
+        // a run continuing from the previous words into the low bits
+        const UINT lowFree = bitScanForward64(~bits);
+        if (run && run + lowFree >= n) {
+            *pos = runStart;
+            return true;
+        }
+
+        if (n <= 64) {
+            const UINT64 starts = runStarts(bits, n);
+            if (starts) {
+                *pos = w * 64 + bitScanForward64(starts);
+                return true;
+            }
+        }
+
+        // the free bits at the top may start a run into the next word
+        run = 63 - bitScanReverse64(~bits);
+        runStart = w * 64 + 64 - run;
+        ++w;
+    }
+    return false;
+}
+
+void DescHeapMgr::markUsed(Heap &heap, UINT pos, UINT n)
+{
+    heap.freeCount -= n;
+    while (n) {
+        const UINT w = pos / 64;
+        const UINT first = pos % 64;
+        const UINT count = (std::min)(n, 64 - first);
+        heap.freeMap[w] &= ~wordMask(first, count);
+        if (!heap.freeMap[w])
+            heap.summary[w / 64] &= ~(UINT64(1) << (w % 64));
+        pos += count;
+        n -= count;
+    }
+}
+
+void DescHeapMgr::markFree(Heap &heap, UINT pos, UINT n)
+{
+    heap.freeCount += n;
+    while (n) {
+        const UINT w = pos / 64;
+        const UINT first = pos % 64;
+        const UINT count = (std::min)(n, 64 - first);
+        heap.freeMap[w] |= wordMask(first, count);
+        heap.summary[w / 64] |= UINT64(1) << (w % 64);
+        pos += count;
+        n -= count;
+    }
+}
+
+UINT DescHeapMgr::largestFreeRun(const Heap &heap)
+{
+    UINT best = 0;
+    UINT run = 0;
+    for (UINT64 bits : heap.freeMap) {
+        if (bits == ALL_FREE) {
+            run += 64;
+            continue;
+        }
+        if (!bits) {
+            best = (std::max)(best, run);
+            run = 0;
+            continue;
+        }
+        best = (std::max)(best, run + bitScanForward64(~bits));
+        // runs entirely inside the word
+        for (UINT64 w = bits; w; ) {
+            const UINT first = bitScanForward64(w);
+            const UINT64 rest = ~w & (ALL_FREE << first);
+            const UINT end = rest ? bitScanForward64(rest) : 64;
+            best = (std::max)(best, end - first);
+            w &= end == 64 ? 0 : (ALL_FREE << end);
+        }
+        run = 63 - bitScanReverse64(~bits);
+    }
+    return (std::max)(best, run);
+}
+
+// m_mutex, with the time spent waiting for and holding it recorded
+struct DescHeapMgr::Lock
+{
+    Lock(DescHeapMgr *mgr) : m_mgr(mgr)
+    {
+        if (ENABLE_DESC_HEAP_STATS) {
+            Timestamp waitStart;
+            m_mgr->m_mutex.lock();
+            m_acquired.start();
+            m_mgr->m_lockWait.record(m_acquired.elapsedNsSince(waitStart));
+        } else {
+            m_mgr->m_mutex.lock();
+        }
+    }
+    ~Lock()
+    {
+        if (ENABLE_DESC_HEAP_STATS)
+            m_mgr->m_lockHold.record(m_acquired.elapsedNs());
+        m_mgr->m_mutex.unlock();
+    }
+    Lock(const Lock &) = delete;
+    Lock &operator=(const Lock &) = delete;
+
+    DescHeapMgr *m_mgr;
+    Timestamp m_acquired;
+};
+
+// Serials are unique across instances, so a cache left behind by a destroyed
+// manager is never taken for one of a new manager at the same address.
+static std::atomic<UINT64> s_nextSerial { 1 };
+
+// Initialized managers by serial, for thread caches handing their slots back
+// on thread exit. Taken before a manager's lock, never while holding one.
+static std::mutex s_liveMutex;
+static std::map<UINT64, DescHeapMgr *> s_liveManagers;
+
+struct DescHeapMgr::ThreadCache
+{
+    ~ThreadCache();
+
+    DescHeapMgr *owner = nullptr;
+    UINT64 serial = 0;
+    std::vector<SIZE_T> freeSlots[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    std::vector<SIZE_T> released; // any type, returned in one go
+    // [start, end) CPU addresses of the non-shader-visible heaps as of
+    // heapGeneration, only singles from these are cached on release
+    UINT64 heapGeneration = ~UINT64(0);
+    std::vector<std::pair<SIZE_T, SIZE_T>> cacheableHeaps;
+
+    bool isCacheable(SIZE_T ptr) const
+    {
+        for (const std::pair<SIZE_T, SIZE_T> &h : cacheableHeaps) {
+            if (ptr >= h.first && ptr < h.second)
+                return true;
+        }
+        return false;
+    }
+};
+
+DescHeapMgr::ThreadCache::~ThreadCache()
+{
+    // the thread exits, slots of heaps that still exist go back to them
+    std::lock_guard<std::mutex> liveLock(s_liveMutex);
+    auto it = s_liveManagers.find(serial);
+    if (it != s_liveManagers.end() && it->second == owner) {
+        Lock lock(owner);
+        owner->flushThreadCacheLocked(this);
+    }
+}
+
+DescHeapMgr::ThreadCache *DescHeapMgr::threadCache()
+{
+    static thread_local ThreadCache t_cache;
+    ThreadCache *cache = &t_cache;
+    const UINT64 serial = m_serial.load(std::memory_order_acquire);
+    if (cache->owner != this || cache->serial != serial) {
+        // whatever is in there belongs to heaps that are gone or to another manager
+        for (std::vector<SIZE_T> &slots : cache->freeSlots)
+            slots.clear();
+        cache->released.clear();
+        cache->heapGeneration = ~UINT64(0);
+        cache->cacheableHeaps.clear();
+        cache->owner = this;
+        cache->serial = serial;
+    }
+    return cache;
+}
+
+void DescHeapMgr::refreshCacheableHeaps(ThreadCache *cache)
+{
+    cache->cacheableHeaps.clear();
+    for (const Heap *heap : m_heaps) {
+        if (heap->flags == D3D12_DESCRIPTOR_HEAP_FLAG_NONE)
+            cache->cacheableHeaps.push_back({ heap->start.ptr, heap->start.ptr + SIZE_T(heap->capacity) * heap->handleSize });
+    }
+    cache->heapGeneration = m_heapGeneration.load(std::memory_order_relaxed);
+}
 
 D3D12_CPU_DESCRIPTOR_HANDLE DescHeapMgr::allocate(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, D3D12_DESCRIPTOR_HEAP_FLAGS flags)
+{
+    return allocate(type, n, flags, RETURN_ADDRESS());
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescHeapMgr::allocate(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, D3D12_DESCRIPTOR_HEAP_FLAGS flags,
+    void *callSite)
 {
     if (n < 1)
         return {};
-    std::lock_guard<std::mutex> lock(m_mutex);
 
-    D3D12_CPU_DESCRIPTOR_HANDLE h = {};
-    for (Heap &heap : m_heaps) {
-        if (heap.type != type || heap.flags != flags)
-            continue;
+    if (ENABLE_DESC_HEAP_STATS)
+        m_allocations.fetch_add(1, std::memory_order_relaxed);
 
-        for (UINT startBucket = 0; startBucket < _countof(heap.freeMap); ++startBucket) {
-            UINT32 map = heap.freeMap[startBucket];
-            while (map) {
-                DWORD freePosInBucket;
-                _BitScanForward(&freePosInBucket, map);
-                const UINT freePos = freePosInBucket + startBucket * DESCRIPTORS_PER_BUCKET;
-
-                // are there n consecutive free entries starting at freePos?
-                bool canUse = true;
-                for (UINT pos = freePos + 1; pos < freePos + n; ++pos) {
-                    const UINT bucket = pos / DESCRIPTORS_PER_BUCKET;
-                    const UINT indexInBucket = pos - bucket * DESCRIPTORS_PER_BUCKET;
-                    if (!(heap.freeMap[bucket] & (1UL << indexInBucket))) {
-                        canUse = false;
-                        break;
-                    }
-                }
+    if (TRACK_DESCRIPTOR_LEAKS) {
+        Lock lock(this);
+        D3D12_CPU_DESCRIPTOR_HANDLE h = allocateLocked(type, n, flags);
+        if (h.ptr)
+            m_trackedRanges[h.ptr] = { n, callSite };
+        return h;
+    }
 
-                if (canUse) {
-                    for (UINT pos = freePos; pos < freePos + n; ++pos) {
-                        const UINT bucket = pos / DESCRIPTORS_PER_BUCKET;
-                        const UINT indexInBucket = pos - bucket * DESCRIPTORS_PER_BUCKET;
-                        heap.freeMap[bucket] &= ~(1UL << indexInBucket);
-                        //log("reserve descriptor handle, heap %p type %x bucket %u index %u",
-                        //    &heap, type, bucket, indexInBucket);
-                    }
-                    h.ptr = heap.start.ptr + SIZE_T(freePos) * heap.handleSize;
-                    return h;
-                }
+    if (n == 1 && flags == D3D12_DESCRIPTOR_HEAP_FLAG_NONE) {
+        ThreadCache *cache = threadCache();
+        std::vector<SIZE_T> &slots(cache->freeSlots[type]);
+        if (slots.empty()) {
+            Lock lock(this);
+            if (cache->serial != m_serial.load(std::memory_order_relaxed))
+                return allocateLocked(type, 1, flags);
+            D3D12_CPU_DESCRIPTOR_HANDLE batch = allocateLocked(type, CACHE_BATCH, flags);
+            if (!batch.ptr)
+                return allocateLocked(type, 1, flags);
+            // handed out lowest first
+            for (UINT i = CACHE_BATCH; i > 0; --i)
+                slots.push_back(batch.ptr + SIZE_T(i - 1) * m_handleSizes[type]);
+        }
+        D3D12_CPU_DESCRIPTOR_HANDLE h;
+        h.ptr = slots.back();
+        slots.pop_back();
+        return h;
+    }
 
-                map &= ~(1UL << freePosInBucket);
-            }
+    Lock lock(this);
+    return allocateLocked(type, n, flags);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescHeapMgr::allocateLocked(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, D3D12_DESCRIPTOR_HEAP_FLAGS flags)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE h = {};
+    for (Heap *heapPtr : m_heaps) {
+        Heap &heap(*heapPtr);
+        if (heap.type != type || heap.flags != flags || heap.freeCount < n)
+            continue;
+
+        UINT freePos;
+        if (findFreeRun(heap, n, &freePos)) {
+            markUsed(heap, freePos, n);
+            //log("reserve descriptor handles, heap %p type %x pos %u count %u", &heap, type, freePos, n);
+            h.ptr = heap.start.ptr + SIZE_T(freePos) * heap.handleSize;
+            return h;
         }
     }
 
-    Heap heap;
+    Heap *heapPtr = new Heap;
+    Heap &heap(*heapPtr);
     heap.type = type;
     heap.flags = flags;
     heap.handleSize = m_handleSizes[type];
+    heap.capacity = (std::max)(n, m_nextHeapSize[type]);
 
     D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-    heapDesc.NumDescriptors = MAX_DESCRIPTORS_PER_HEAP;
+    heapDesc.NumDescriptors = heap.capacity;
     heapDesc.Type = type;
     heapDesc.Flags = flags;
 
-    HRESULT hr = m_device->CreateDescriptorHeap(&heapDesc, IID_ID3D12DescriptorHeap, reinterpret_cast<void **>(&heap.heap));
-    if (FAILED(hr)) {
-        log("Failed to create descriptor heap", hr);
+    heap.gpuStart = {};
+    heap.heap = m_backend->createDescriptorHeap(heapDesc, &heap.start,
+        (flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) ? &heap.gpuStart : nullptr);
+    if (!heap.heap) {
+        delete heapPtr;
+        ++m_failedAllocations;
         return h;
     }
+    ++m_heapsCreated;
 
-    heap.start = heap.heap->GetCPUDescriptorHandleForHeapStart();
-    //log("new descriptor heap, type %x, start %llu", type, heap.start.ptr);
+    //log("new descriptor heap, type %x, start %llu, size %u", type, heap.start.ptr, heap.capacity);
 
-    for (int i = 0; i < _countof(heap.freeMap); ++i)
-        heap.freeMap[i] = 0xFFFFFFFF;
+    const HeapPolicy &policy(m_policies[type]);
+    if (m_nextHeapSize[type] < policy.maxSize)
+        m_nextHeapSize[type] = UINT((std::min)(UINT64(m_nextHeapSize[type]) * policy.growthFactor, UINT64(policy.maxSize)));
 
-    for (UINT pos = 0; pos < n; ++pos) {
-        const UINT bucket = pos / DESCRIPTORS_PER_BUCKET;
-        const UINT indexInBucket = pos - bucket * DESCRIPTORS_PER_BUCKET;
-        heap.freeMap[bucket] &= ~(1UL << indexInBucket);
-    }
+    // bits past the capacity stay 0, so they are never handed out
+    const UINT wordCount = aligned(heap.capacity, 64U) / 64;
+    heap.freeMap.assign(wordCount, 0);
+    heap.summary.assign(aligned(wordCount, 64U) / 64, 0);
+    heap.freeCount = 0;
+    markFree(heap, 0, heap.capacity);
+    markUsed(heap, 0, n);
 
     h = heap.start;
-    m_heaps.push_back(heap);
+    m_heaps.push_back(heapPtr);
+    m_heapsByAddress[heap.start.ptr] = heapPtr;
+    m_heapGeneration.fetch_add(1, std::memory_order_release);
 
     return h;
 }
@@ -84,24 +343,222 @@ void DescHeapMgr::release(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n)
 {
     if (n < 1)
         return;
-    std::lock_guard<std::mutex> lock(m_mutex);
-
-    for (Heap &heap : m_heaps) {
-        if(handle.ptr >= heap.start.ptr
-            && handle.ptr + n * heap.handleSize <= heap.start.ptr + MAX_DESCRIPTORS_PER_HEAP * heap.handleSize)
-        {
-            const SIZE_T startPos = (handle.ptr - heap.start.ptr) / heap.handleSize;
-            for (SIZE_T pos = startPos; pos < startPos + n; ++pos) {
-                const UINT bucket = UINT(pos) / DESCRIPTORS_PER_BUCKET;
-                const UINT indexInBucket = UINT(pos) - bucket * DESCRIPTORS_PER_BUCKET;
-                heap.freeMap[bucket] |= 1UL << indexInBucket;
-                //log("free descriptor handle, heap %p type %x bucket %u index %u",
-                //    &heap, heap.type, bucket, indexInBucket);
+
+    if (n == 1 && !TRACK_DESCRIPTOR_LEAKS) {
+        ThreadCache *cache = threadCache();
+        if (cache->heapGeneration != m_heapGeneration.load(std::memory_order_acquire)) {
+            Lock lock(this);
+            refreshCacheableHeaps(cache);
+        }
+        // shader-visible singles bypass the cache, same as when allocating
+        if (cache->isCacheable(handle.ptr)) {
+            cache->released.push_back(handle.ptr);
+            if (cache->released.size() < CACHE_BATCH)
+                return;
+            Lock lock(this);
+            if (cache->serial == m_serial.load(std::memory_order_relaxed)) {
+                for (SIZE_T ptr : cache->released) {
+                    D3D12_CPU_DESCRIPTOR_HANDLE h;
+                    h.ptr = ptr;
+                    releaseLocked(h, 1);
+                }
             }
+            cache->released.clear();
             return;
         }
     }
-    log("Attempted to release untracked descriptor handle %llu", handle.ptr);
+
+    Lock lock(this);
+    releaseLocked(handle, n);
+}
+
+void DescHeapMgr::flushThreadCache()
+{
+    ThreadCache *cache = threadCache();
+    Lock lock(this);
+    flushThreadCacheLocked(cache);
+}
+
+void DescHeapMgr::flushThreadCacheLocked(ThreadCache *cache)
+{
+    if (cache->serial == m_serial.load(std::memory_order_relaxed)) {
+        D3D12_CPU_DESCRIPTOR_HANDLE h;
+        for (std::vector<SIZE_T> &slots : cache->freeSlots) {
+            for (SIZE_T ptr : slots) {
+                h.ptr = ptr;
+                releaseLocked(h, 1);
+            }
+        }
+        for (SIZE_T ptr : cache->released) {
+            h.ptr = ptr;
+            releaseLocked(h, 1);
+        }
+    }
+    for (std::vector<SIZE_T> &slots : cache->freeSlots)
+        slots.clear();
+    cache->released.clear();
+}
+
+void DescHeapMgr::releaseDeferred(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n, UINT64 fenceValue)
+{
+    if (n < 1)
+        return;
+    Lock lock(this);
+    m_deferredReleases.push_back({ handle, n, fenceValue });
+}
+
+void DescHeapMgr::reclaimDeferred(UINT64 completedFenceValue)
+{
+    Lock lock(this);
+    size_t kept = 0;
+    for (const DeferredRelease &r : m_deferredReleases) {
+        if (r.fenceValue <= completedFenceValue)
+            releaseLocked(r.handle, r.n);
+        else
+            m_deferredReleases[kept++] = r;
+    }
+    m_deferredReleases.resize(kept);
+}
+
+void DescHeapMgr::release(const Range *ranges, size_t count)
+{
+    Lock lock(this);
+    for (size_t i = 0; i < count; ++i) {
+        if (ranges[i].n)
+            releaseLocked(ranges[i].handle, ranges[i].n);
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescHeapMgr::allocateMovable(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, RelocateFunc relocate)
+{
+    void *callSite = RETURN_ADDRESS();
+    if (n < 1)
+        return {};
+
+    if (ENABLE_DESC_HEAP_STATS)
+        m_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    Lock lock(this);
+    D3D12_CPU_DESCRIPTOR_HANDLE h = allocateLocked(type, n, D3D12_DESCRIPTOR_HEAP_FLAG_NONE);
+    if (h.ptr) {
+        m_movableRanges[h.ptr] = { n, relocate };
+        if (TRACK_DESCRIPTOR_LEAKS)
+            m_trackedRanges[h.ptr] = { n, callSite };
+    }
+    return h;
+}
+
+void DescHeapMgr::releaseMovable(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n)
+{
+    if (n < 1)
+        return;
+    Lock lock(this);
+    m_movableRanges.erase(handle.ptr);
+    releaseLocked(handle, n);
+}
+
+UINT DescHeapMgr::compact(D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+    struct Relocation {
+        D3D12_CPU_DESCRIPTOR_HANDLE oldHandle;
+        D3D12_CPU_DESCRIPTOR_HANDLE newHandle;
+        UINT n;
+        RelocateFunc relocate;
+    };
+    std::vector<Relocation> relocations;
+    UINT releasedCount = 0;
+    {
+        Lock lock(this);
+        std::vector<Heap *> heaps;
+        for (Heap *heap : m_heaps) {
+            if (heap->type == type && heap->flags == D3D12_DESCRIPTOR_HEAP_FLAG_NONE)
+                heaps.push_back(heap);
+        }
+        // least used first; each is emptied into the fuller ones after it, most used first
+        std::sort(heaps.begin(), heaps.end(), [](const Heap *a, const Heap *b) {
+            return a->capacity - a->freeCount < b->capacity - b->freeCount;
+        });
+
+        for (size_t i = 0; i + 1 < heaps.size(); ++i) {
+            Heap &src(*heaps[i]);
+            const SIZE_T srcEnd = src.start.ptr + SIZE_T(src.capacity) * src.handleSize;
+            UINT movable = 0;
+            for (auto it = m_movableRanges.lower_bound(src.start.ptr); it != m_movableRanges.end() && it->first < srcEnd; ++it)
+                movable += it->second.n;
+            if (movable != src.capacity - src.freeCount)
+                continue;
+
+            // moved ranges get new keys elsewhere in the map, possibly past any precomputed end
+            for (auto it = m_movableRanges.lower_bound(src.start.ptr); it != m_movableRanges.end() && it->first < srcEnd; ) {
+                const UINT n = it->second.n;
+                D3D12_CPU_DESCRIPTOR_HANDLE newHandle = {};
+                for (size_t j = heaps.size() - 1; j > i && !newHandle.ptr; --j) {
+                    Heap &dst(*heaps[j]);
+                    UINT pos;
+                    if (dst.freeCount >= n && findFreeRun(dst, n, &pos)) {
+                        markUsed(dst, pos, n);
+                        newHandle.ptr = dst.start.ptr + SIZE_T(pos) * dst.handleSize;
+                    }
+                }
+                if (!newHandle.ptr)
+                    break;
+
+                D3D12_CPU_DESCRIPTOR_HANDLE oldHandle;
+                oldHandle.ptr = it->first;
+                m_backend->copyDescriptorsSimple(n, newHandle, oldHandle, type);
+                markFree(src, UINT((oldHandle.ptr - src.start.ptr) / src.handleSize), n);
+                relocations.push_back({ oldHandle, newHandle, n, it->second.relocate });
+                m_movableRanges[newHandle.ptr] = it->second;
+                if (TRACK_DESCRIPTOR_LEAKS) {
+                    m_trackedRanges[newHandle.ptr] = m_trackedRanges[oldHandle.ptr];
+                    m_trackedRanges.erase(oldHandle.ptr);
+                }
+                it = m_movableRanges.erase(it);
+            }
+
+            if (src.freeCount == src.capacity) {
+                m_heapsByAddress.erase(src.start.ptr);
+                m_heaps.erase(std::find(m_heaps.begin(), m_heaps.end(), &src));
+                m_heapGeneration.fetch_add(1, std::memory_order_release);
+                m_backend->releaseDescriptorHeap(src.heap);
+                delete &src;
+                ++releasedCount;
+            }
+        }
+        m_heapsReleased += releasedCount;
+    }
+
+    for (const Relocation &r : relocations) {
+        if (r.relocate)
+            r.relocate(r.oldHandle, r.newHandle, r.n);
+    }
+    return releasedCount;
+}
+
+DescHeapMgr::Heap *DescHeapMgr::heapForHandle(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n) const
+{
+    // the last heap starting at or before the handle is the only candidate
+    auto it = m_heapsByAddress.upper_bound(handle.ptr);
+    if (it == m_heapsByAddress.cbegin())
+        return nullptr;
+    Heap *heap = (--it)->second;
+    if (handle.ptr + SIZE_T(n) * heap->handleSize > heap->start.ptr + SIZE_T(heap->capacity) * heap->handleSize)
+        return nullptr;
+    return heap;
+}
+
+void DescHeapMgr::releaseLocked(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n)
+{
+    Heap *heap = heapForHandle(handle, n);
+    if (!heap) {
+        log("Attempted to release untracked descriptor handle %llu", handle.ptr);
+        return;
+    }
+    const UINT startPos = UINT((handle.ptr - heap->start.ptr) / heap->handleSize);
+    markFree(*heap, startPos, n);
+    if (TRACK_DESCRIPTOR_LEAKS)
+        m_trackedRanges.erase(handle.ptr);
+    //log("free descriptor handles, heap %p type %x pos %u count %u", heap, heap->type, startPos, n);
 }
 
 UINT DescHeapMgr::handleSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const
@@ -109,17 +566,177 @@ UINT DescHeapMgr::handleSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const
     return m_handleSizes[type];
 }
 
-void DescHeapMgr::initialize(ID3D12Device *device)
+static D3D12_DESCRIPTOR_HEAP_TYPE heapTypeForView(DescHeapMgr::ViewDesc::Type type)
 {
-    m_device = device;
+    switch (type) {
+    case DescHeapMgr::ViewDesc::RenderTarget:
+        return D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+    case DescHeapMgr::ViewDesc::DepthStencil:
+        return D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    default:
+        return D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescHeapMgr::createViews(const ViewDesc *views, UINT count)
+{
+    void *callSite = RETURN_ADDRESS();
+    if (count < 1)
+        return {};
+
+    const D3D12_DESCRIPTOR_HEAP_TYPE type = heapTypeForView(views[0].type);
+    for (UINT i = 1; i < count; ++i) {
+        if (heapTypeForView(views[i].type) != type) {
+            log("View %u does not go into the same kind of descriptor heap as view 0", i);
+            return {};
+        }
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE first = allocate(type, count, D3D12_DESCRIPTOR_HEAP_FLAG_NONE, callSite);
+    if (!first.ptr)
+        return first;
+
+    ID3D12Device *dev = m_backend->device();
+    if (!dev)
+        return first;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE h = first;
+    for (UINT i = 0; i < count; ++i) {
+        const ViewDesc &v(views[i]);
+        switch (v.type) {
+        case ViewDesc::RenderTarget:
+            dev->CreateRenderTargetView(v.resource, v.rtv, h);
+            break;
+        case ViewDesc::DepthStencil:
+            dev->CreateDepthStencilView(v.resource, v.dsv, h);
+            break;
+        case ViewDesc::ShaderResource:
+            dev->CreateShaderResourceView(v.resource, v.srv, h);
+            break;
+        case ViewDesc::ConstantBuffer:
+            dev->CreateConstantBufferView(v.cbv, h);
+            break;
+        case ViewDesc::UnorderedAccess:
+            dev->CreateUnorderedAccessView(v.resource, v.counter, v.uav, h);
+            break;
+        }
+        h.ptr += m_handleSizes[type];
+    }
+    return first;
+}
+
+ID3D12DescriptorHeap *DescHeapMgr::shaderVisibleHeap(D3D12_CPU_DESCRIPTOR_HANDLE handle, D3D12_GPU_DESCRIPTOR_HANDLE *gpuHandle)
+{
+    Lock lock(this);
+    const Heap *heap = heapForHandle(handle, 1);
+    if (!heap || !(heap->flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE))
+        return nullptr;
+    gpuHandle->ptr = heap->gpuStart.ptr + (handle.ptr - heap->start.ptr);
+    return heap->heap;
+}
+
+DescHeapMgr::DescHeapMgr()
+{
+    // shader-visible sampler heaps cannot have more than 2048 descriptors
+    m_policies[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV] = { 4096, 65536, 2 };
+    m_policies[D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER] = { 256, 2048, 2 };
+    m_policies[D3D12_DESCRIPTOR_HEAP_TYPE_RTV] = { 64, 1024, 2 };
+    m_policies[D3D12_DESCRIPTOR_HEAP_TYPE_DSV] = { 64, 1024, 2 };
     for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
-        m_handleSizes[i] = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE(i));
+        m_nextHeapSize[i] = m_policies[i].initialSize;
+}
+
+DescHeapMgr::~DescHeapMgr()
+{
+    std::lock_guard<std::mutex> liveLock(s_liveMutex);
+    s_liveManagers.erase(m_serial.load(std::memory_order_relaxed));
+}
+
+void DescHeapMgr::setHeapPolicy(D3D12_DESCRIPTOR_HEAP_TYPE type, const HeapPolicy &policy)
+{
+    Lock lock(this);
+    m_policies[type] = policy;
+    m_nextHeapSize[type] = policy.initialSize;
+}
+
+void DescHeapMgr::initialize(GpuBackend *backend)
+{
+    {
+        std::lock_guard<std::mutex> liveLock(s_liveMutex);
+        s_liveManagers.erase(m_serial.load(std::memory_order_relaxed));
+        m_serial.store(s_nextSerial.fetch_add(1), std::memory_order_release);
+        s_liveManagers[m_serial.load(std::memory_order_relaxed)] = this;
+    }
+    m_backend = backend;
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+        m_handleSizes[i] = m_backend->descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE(i));
 }
 
 void DescHeapMgr::releaseResources()
 {
-    for (Heap &heap : m_heaps)
-        heap.heap->Release();
+    {
+        // before taking the lock, see s_liveMutex
+        std::lock_guard<std::mutex> liveLock(s_liveMutex);
+        s_liveManagers.erase(m_serial.load(std::memory_order_relaxed));
+    }
+    Lock lock(this);
+    if (TRACK_DESCRIPTOR_LEAKS) {
+        // released but still waiting for the GPU is not a leak
+        for (const DeferredRelease &r : m_deferredReleases)
+            m_trackedRanges.erase(r.handle.ptr);
+        for (const auto &r : m_trackedRanges)
+            log("Leaked %u descriptor(s) at %llu, allocated from %p", r.second.n, UINT64(r.first), r.second.callSite);
+        m_trackedRanges.clear();
+    }
+    m_serial.store(s_nextSerial.fetch_add(1), std::memory_order_release);
+    for (Heap *heap : m_heaps) {
+        m_backend->releaseDescriptorHeap(heap->heap);
+        delete heap;
+    }
     m_heaps.clear();
-    m_device = nullptr;
+    m_heapsByAddress.clear();
+    m_deferredReleases.clear();
+    m_movableRanges.clear();
+    m_backend = nullptr;
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+        m_nextHeapSize[i] = m_policies[i].initialSize;
+}
+
+DescHeapMgr::Stats DescHeapMgr::stats()
+{
+    Lock lock(this);
+    Stats s = {};
+    for (const Heap *heap : m_heaps) {
+        TypeStats &t(s.types[heap->type]);
+        ++t.heapCount;
+        t.capacity += heap->capacity;
+        t.used += heap->capacity - heap->freeCount;
+        t.largestFreeRun = (std::max)(t.largestFreeRun, largestFreeRun(*heap));
+    }
+    s.allocations = m_allocations.load(std::memory_order_relaxed);
+    s.failedAllocations = m_failedAllocations;
+    s.heapsCreated = m_heapsCreated;
+    s.heapsReleased = m_heapsReleased;
+    s.pendingDeferred = m_deferredReleases.size();
+    return s;
+}
+
+void DescHeapMgr::logStats()
+{
+    static const char *typeNames[] = { "CBV_SRV_UAV", "SAMPLER", "RTV", "DSV" };
+    const Stats s = stats();
+    log("Descriptor heaps: allocations %llu failed %llu heaps created %llu released %llu deferred releases %llu",
+        s.allocations, s.failedAllocations, s.heapsCreated, s.heapsReleased, UINT64(s.pendingDeferred));
+    for (int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i) {
+        const TypeStats &t(s.types[i]);
+        if (!t.heapCount)
+            continue;
+        log("  %s: heaps %u capacity %u used %u (%u%%) largest free run %u",
+            typeNames[i], t.heapCount, t.capacity, t.used, UINT(UINT64(t.used) * 100 / t.capacity), t.largestFreeRun);
+    }
+    if (ENABLE_DESC_HEAP_STATS) {
+        log("  lock wait: count %llu p50 %lld ns p99 %lld ns max %lld ns, hold p50 %lld ns p99 %lld ns max %lld ns",
+            m_lockWait.count(), m_lockWait.percentile(50), m_lockWait.percentile(99), m_lockWait.maxValue(),
+            m_lockHold.percentile(50), m_lockHold.percentile(99), m_lockHold.maxValue());
+    }
 }
@@ -1,35 +1,189 @@
 #ifndef DESCHEAPMGR_H
 #define DESCHEAPMGR_H
 
-#include "common.h"
+#include "gpubackend.h"
+#include "histogram.h"
 
 struct DescHeapMgr
 {
-    void initialize(ID3D12Device *device);
+    // How big the heaps of a type get. The first heap has initialSize
+    // descriptors, each further one growthFactor times the previous, up to
+    // maxSize. A range larger than maxSize gets a heap of its own size.
+    struct HeapPolicy {
+        UINT initialSize;
+        UINT maxSize;
+        UINT growthFactor;
+    };
+
+    DescHeapMgr();
+    ~DescHeapMgr();
+
+    void initialize(GpuBackend *backend);
     void releaseResources();
 
     D3D12_CPU_DESCRIPTOR_HANDLE allocate(D3D12_DESCRIPTOR_HEAP_TYPE type,
         UINT n,
         D3D12_DESCRIPTOR_HEAP_FLAGS flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE);
     void release(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n);
+    struct Range {
+        D3D12_CPU_DESCRIPTOR_HANDLE handle;
+        UINT n;
+    };
+    // Many ranges under one lock, bypassing the thread caches.
+    void release(const Range *ranges, size_t count);
     UINT handleSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 
-    static const UINT BUCKETS_PER_HEAP = 8;
-    static const UINT DESCRIPTORS_PER_BUCKET = 32;
-    static const UINT MAX_DESCRIPTORS_PER_HEAP = BUCKETS_PER_HEAP * DESCRIPTORS_PER_BUCKET;
+    // A view for createViews(). desc may be null where D3D allows a default
+    // view, counter is for UnorderedAccess only.
+    struct ViewDesc {
+        enum Type {
+            RenderTarget,
+            DepthStencil,
+            ShaderResource,
+            ConstantBuffer,
+            UnorderedAccess
+        };
+        Type type;
+        ID3D12Resource *resource;
+        ID3D12Resource *counter;
+        union {
+            const D3D12_RENDER_TARGET_VIEW_DESC *rtv;
+            const D3D12_DEPTH_STENCIL_VIEW_DESC *dsv;
+            const D3D12_SHADER_RESOURCE_VIEW_DESC *srv;
+            const D3D12_CONSTANT_BUFFER_VIEW_DESC *cbv;
+            const D3D12_UNORDERED_ACCESS_VIEW_DESC *uav;
+        };
+    };
+    // Allocates one contiguous range and creates the views in it, in order.
+    // The types must all go into the same kind of heap. The views are not
+    // created when the backend has no device.
+    D3D12_CPU_DESCRIPTOR_HANDLE createViews(const ViewDesc *views, UINT count);
+    // The heap a shader-visible range was allocated from, for SetDescriptorHeaps,
+    // and the GPU handle of the range. Null for anything else.
+    ID3D12DescriptorHeap *shaderVisibleHeap(D3D12_CPU_DESCRIPTOR_HANDLE handle, D3D12_GPU_DESCRIPTOR_HANDLE *gpuHandle);
+
+    // Applies to heaps created afterwards.
+    void setHeapPolicy(D3D12_DESCRIPTOR_HEAP_TYPE type, const HeapPolicy &policy);
+    const HeapPolicy &heapPolicy(D3D12_DESCRIPTOR_HEAP_TYPE type) const { return m_policies[type]; }
+
+    // Single non-shader-visible descriptors go through a per-thread cache that
+    // is refilled and flushed CACHE_BATCH at a time, so most of them take no
+    // lock. Cached slots stay reserved until flushThreadCache() is called on
+    // that thread, the thread exits, or releaseResources(). Shader-visible
+    // singles are never cached, on release this is told apart by the heap
+    // address range.
+    void flushThreadCache();
+    static const UINT CACHE_BATCH = 32;
+
+    // For ranges the GPU may still read: the range is freed by the first
+    // reclaimDeferred() that sees the fence at or past fenceValue.
+    void releaseDeferred(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n, UINT64 fenceValue);
+    void reclaimDeferred(UINT64 completedFenceValue);
 
-    ID3D12Device *m_device = nullptr;
+    // Ranges that compact() may move. relocate is called with the new handle
+    // after the descriptors were copied there, outside the lock. Only for
+    // non-shader-visible heaps, since those are the only valid copy sources.
+    // Must be freed with releaseMovable().
+    using RelocateFunc = std::function<void(D3D12_CPU_DESCRIPTOR_HANDLE oldHandle, D3D12_CPU_DESCRIPTOR_HANDLE newHandle, UINT n)>;
+    D3D12_CPU_DESCRIPTOR_HANDLE allocateMovable(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, RelocateFunc relocate);
+    void releaseMovable(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n);
+    // Empties the least used non-shader-visible heaps of the type by moving
+    // their ranges into the others, then releases the empty heaps. A heap
+    // holding anything but movable ranges (this includes slots cached by
+    // threads that did not flushThreadCache()) is left alone. Nothing may be
+    // allocating or using the moved descriptors meanwhile. Returns the number
+    // of heaps released.
+    UINT compact(D3D12_DESCRIPTOR_HEAP_TYPE type);
+
+    // Occupancy per heap type. used includes descriptors sitting in thread
+    // caches. A largestFreeRun well below the free count means fragmentation.
+    struct TypeStats {
+        UINT heapCount;
+        UINT capacity;
+        UINT used;
+        UINT largestFreeRun;
+    };
+    struct Stats {
+        TypeStats types[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+        UINT64 allocations; // allocate() calls
+        UINT64 failedAllocations;
+        UINT64 heapsCreated;
+        UINT64 heapsReleased; // by compact()
+        size_t pendingDeferred;
+    };
+    Stats stats();
+    void logStats();
+    // Time spent waiting for and holding m_mutex, recorded when ENABLE_DESC_HEAP_STATS is set.
+    const Histogram &lockWaitStats() const { return m_lockWait; }
+    const Histogram &lockHoldStats() const { return m_lockHold; }
+    void resetLockStats() { m_lockWait.reset(); m_lockHold.reset(); }
+
+    GpuBackend *m_backend = nullptr;
     std::mutex m_mutex;
+    // freeMap has a bit per descriptor, set when free. summary has a bit per
+    // freeMap word, set when that word has any free bit, so full stretches of
+    // the heap are skipped 64 words at a time.
     struct Heap {
         D3D12_DESCRIPTOR_HEAP_TYPE type;
         D3D12_DESCRIPTOR_HEAP_FLAGS flags;
         ID3D12DescriptorHeap *heap;
         D3D12_CPU_DESCRIPTOR_HANDLE start;
+        D3D12_GPU_DESCRIPTOR_HANDLE gpuStart; // shader-visible heaps only
         UINT handleSize;
-        UINT32 freeMap[BUCKETS_PER_HEAP];
+        UINT capacity;
+        UINT freeCount;
+        std::vector<UINT64> freeMap;
+        std::vector<UINT64> summary;
     };
-    std::vector<Heap> m_heaps;
+    std::vector<Heap *> m_heaps;
+    std::map<SIZE_T, Heap *> m_heapsByAddress; // keyed by the CPU start address
     UINT m_handleSizes[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    HeapPolicy m_policies[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    UINT m_nextHeapSize[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    std::atomic<UINT64> m_serial { 0 }; // changes when the heaps go away, invalidating the thread caches
+    std::atomic<UINT64> m_heapGeneration { 0 }; // changes whenever a heap is created or released
+    struct DeferredRelease {
+        D3D12_CPU_DESCRIPTOR_HANDLE handle;
+        UINT n;
+        UINT64 fenceValue;
+    };
+    std::vector<DeferredRelease> m_deferredReleases;
+    std::atomic<UINT64> m_allocations { 0 };
+    UINT64 m_failedAllocations = 0;
+    UINT64 m_heapsCreated = 0;
+    UINT64 m_heapsReleased = 0;
+    struct MovableRange {
+        UINT n;
+        RelocateFunc relocate;
+    };
+    std::map<SIZE_T, MovableRange> m_movableRanges; // keyed by the CPU address
+    Histogram m_lockWait;
+    Histogram m_lockHold;
+    // TRACK_DESCRIPTOR_LEAKS: outstanding ranges by CPU address. The thread
+    // caches are bypassed so that every range has its own call site.
+    struct TrackedRange {
+        UINT n;
+        void *callSite;
+    };
+    std::map<SIZE_T, TrackedRange> m_trackedRanges;
+
+private:
+    struct Lock;
+    struct ThreadCache;
+    ThreadCache *threadCache();
+    void refreshCacheableHeaps(ThreadCache *cache);
+    void flushThreadCacheLocked(ThreadCache *cache);
+    // callSite is the RETURN_ADDRESS() of the public entry point, recorded
+    // for TRACK_DESCRIPTOR_LEAKS
+    D3D12_CPU_DESCRIPTOR_HANDLE allocate(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, D3D12_DESCRIPTOR_HEAP_FLAGS flags,
+        void *callSite);
+    D3D12_CPU_DESCRIPTOR_HANDLE allocateLocked(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT n, D3D12_DESCRIPTOR_HEAP_FLAGS flags);
+    void releaseLocked(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n);
+    Heap *heapForHandle(D3D12_CPU_DESCRIPTOR_HANDLE handle, UINT n) const;
+    static bool findFreeRun(const Heap &heap, UINT n, UINT *pos);
+    static void markUsed(Heap &heap, UINT pos, UINT n);
+    static void markFree(Heap &heap, UINT pos, UINT n);
+    static UINT largestFreeRun(const Heap &heap);
 };
 
 #endif
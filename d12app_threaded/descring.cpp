@@ -0,0 +1,70 @@
+#include "descring.h"
+#include "desccopy.h"
+
+bool DescRing::initialize(GpuBackend *backend, UINT capacity, UINT reservedCount)
+{
+    m_backend = backend;
+    m_handleSize = m_backend->descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_reservedCount = reservedCount;
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.NumDescriptors = reservedCount + capacity;
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    m_heap = m_backend->createDescriptorHeap(heapDesc, &m_cpuStart, &m_gpuStart);
+    if (!m_heap)
+        return false;
+
+    m_ring.reset(capacity);
+    return true;
+}
+
+void DescRing::releaseResources()
+{
+    if (m_heap) {
+        m_backend->releaseDescriptorHeap(m_heap);
+        m_heap = nullptr;
+    }
+    m_ring.reset(0);
+    m_reservedCount = 0;
+    m_backend = nullptr;
+}
+
+bool DescRing::allocate(UINT n, Range *range)
+{
+    UINT64 pos;
+    if (!m_ring.allocate(n, 1, &pos)) {
+        log("Shader-visible descriptor ring is full (%llu used, %u requested)", m_ring.used(), n);
+        return false;
+    }
+    pos += m_reservedCount;
+    range->cpu.ptr = m_cpuStart.ptr + SIZE_T(pos) * m_handleSize;
+    range->gpu.ptr = m_gpuStart.ptr + pos * m_handleSize;
+    range->count = n;
+    return true;
+}
+
+bool DescRing::stage(D3D12_CPU_DESCRIPTOR_HANDLE src, UINT n, Range *range)
+{
+    if (!allocate(n, range))
+        return false;
+    m_backend->copyDescriptorsSimple(n, range->cpu, src, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return true;
+}
+
+bool DescRing::stage(const D3D12_CPU_DESCRIPTOR_HANDLE *srcs, const UINT *counts, UINT rangeCount, Range *range)
+{
+    UINT n = 0;
+    for (UINT i = 0; i < rangeCount; ++i)
+        n += counts[i];
+    if (!allocate(n, range))
+        return false;
+
+    DescCopyBatch batch(m_backend, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    D3D12_CPU_DESCRIPTOR_HANDLE dst = range->cpu;
+    for (UINT i = 0; i < rangeCount; ++i) {
+        batch.add(dst, srcs[i], counts[i]);
+        dst.ptr += SIZE_T(counts[i]) * m_handleSize;
+    }
+    return true;
+}
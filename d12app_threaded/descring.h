@@ -0,0 +1,50 @@
+#ifndef DESCRING_H
+#define DESCRING_H
+
+#include "gpubackend.h"
+#include "framering.h"
+
+// Per-frame descriptor tables in one shader-visible CBV_SRV_UAV heap. Ranges
+// are never freed individually, the App reclaims a slot's ranges in beginFrame
+// once its fence has passed. Builders stage their descriptors with copies into
+// a range and bind its GPU handle, after setting heap() on the command list.
+// The first reservedCount descriptors of the heap are not part of the ring,
+// the BindlessTable lives there, since a command list can only have one
+// CBV_SRV_UAV heap set.
+struct DescRing
+{
+    struct Range {
+        D3D12_CPU_DESCRIPTOR_HANDLE cpu;
+        D3D12_GPU_DESCRIPTOR_HANDLE gpu;
+        UINT count;
+    };
+
+    bool initialize(GpuBackend *backend, UINT capacity, UINT reservedCount = 0);
+    void releaseResources();
+
+    // All thread-safe. stage() copies n descriptors from contiguous
+    // non-shader-visible ones. The gathering variant fills one table from
+    // rangeCount scattered source ranges with a single coalesced copy.
+    bool allocate(UINT n, Range *range);
+    bool stage(D3D12_CPU_DESCRIPTOR_HANDLE src, UINT n, Range *range);
+    bool stage(const D3D12_CPU_DESCRIPTOR_HANDLE *srcs, const UINT *counts, UINT rangeCount, Range *range);
+
+    void beginFrame(UINT frameSlot) { m_ring.beginFrame(frameSlot); }
+
+    ID3D12DescriptorHeap *heap() const { return m_heap; }
+    UINT handleSize() const { return m_handleSize; }
+    // Start of the reserved descriptors, which are also the start of the heap.
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuStart() const { return m_cpuStart; }
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuStart() const { return m_gpuStart; }
+    UINT reservedCount() const { return m_reservedCount; }
+
+    GpuBackend *m_backend = nullptr;
+    ID3D12DescriptorHeap *m_heap = nullptr;
+    D3D12_CPU_DESCRIPTOR_HANDLE m_cpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE m_gpuStart = {};
+    UINT m_handleSize = 0;
+    UINT m_reservedCount = 0;
+    FrameRing m_ring;
+};
+
+#endif
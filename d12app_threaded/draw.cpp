@@ -106,7 +106,16 @@ void BldRes1::buildResources()
 {
     log("build graphics resources 1");
 
-    d.vbuf = Res::createBuffer(g_app->m_device, Res::Storage::Device, 64);
+    d.vbuf = g_app->m_bufferPool.acquire(Res::Storage::Device, 64);
+    if (d.vbuf) {
+        // goes out on the copy queue; builders drawing with it must addDependency() on this one
+        const float vertices[] = {
+            0.0f, 0.5f, 0.0f,
+            -0.5f, -0.5f, 0.0f,
+            0.5f, -0.5f, 0.0f
+        };
+        uploadToBuffer(d.vbuf, 0, vertices, sizeof(vertices));
+    }
 }
 
 void BldRes1::releaseResources()
@@ -114,7 +123,7 @@ void BldRes1::releaseResources()
     log("release graphics resources 1");
 
     if (d.vbuf) {
-        d.vbuf->Release();
+        g_app->releasePooledBuffer(d.vbuf);
         d.vbuf = nullptr;
     }
 }
@@ -122,7 +131,7 @@ void BldRes1::releaseResources()
 void BldDefaultRt::processEvent(Event e)
 {
     if (e == Event::Build) {
-        D3D12_CPU_DESCRIPTOR_HANDLE *rtv = &g_app->m_rtv[g_app->m_currentFrameSlot];
+        D3D12_CPU_DESCRIPTOR_HANDLE *rtv = &g_app->m_rtv[g_app->m_buildFrameSlot];
         m_drawCmdList->OMSetRenderTargets(1, rtv, false, &g_app->m_dsv);
         const float clearColor[] = { 0.0f, 1.0f, 0.0f, 1.0f };
         m_drawCmdList->ClearRenderTargetView(*rtv, clearColor, 0, nullptr);
@@ -12,14 +12,14 @@ struct BldRes0 : public ResourceBuilder
 
 struct BldRes1 : public ResourceBuilder
 {
-    BldRes1() : ResourceBuilder(Type::NoCommandList) { }
+    BldRes1() : ResourceBuilder(Type::CopyCommandList) { }
     void buildResources() override;
     void releaseResources() override;
 };
 
 struct BldDefaultRt : public Builder
 {
-    BldDefaultRt() : Builder(Type::GraphicsCommandList) { }
+    BldDefaultRt() : Builder(Type::GraphicsCommandList) { setReuseCommandLists(true); }
     void processEvent(Event e) override;
 };
 
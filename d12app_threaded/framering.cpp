@@ -0,0 +1,50 @@
+#include "framering.h"
+#include "common.h"
+
+static_assert(FrameRing::MAX_FRAME_SLOTS >= FRAMES_IN_FLIGHT, "FrameRing needs a slot per frame in flight");
+
+void FrameRing::reset(UINT64 capacity)
+{
+    m_capacity = capacity;
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < MAX_FRAME_SLOTS; ++i)
+        m_frameEnd[i] = 0;
+    m_currentSlot = -1;
+}
+
+bool FrameRing::allocate(UINT64 size, UINT64 alignment, UINT64 *offset)
+{
+    if (!size || size > m_capacity)
+        return false;
+
+    UINT64 head = m_head.load(std::memory_order_relaxed);
+    for (; ;) {
+        // align the offset, not the position, which is only the same when the
+        // capacity is a multiple of the alignment
+        const UINT64 wrapStart = head - head % m_capacity;
+        const UINT64 pos = aligned(head % m_capacity, alignment);
+        // pieces are contiguous, skip what is left at the end instead of wrapping
+        const UINT64 start = pos + size > m_capacity ? wrapStart + m_capacity : wrapStart + pos;
+        if (start + size - m_tail.load(std::memory_order_acquire) > m_capacity)
+            return false; // full
+        if (m_head.compare_exchange_weak(head, start + size, std::memory_order_relaxed)) {
+            *offset = start % m_capacity;
+            return true;
+        }
+    }
+}
+
+void FrameRing::beginFrame(UINT frameSlot)
+{
+    assert(frameSlot < UINT(MAX_FRAME_SLOTS));
+    if (m_currentSlot >= 0)
+        m_frameEnd[m_currentSlot] = m_head.load(std::memory_order_relaxed);
+
+    // the queue is in order, so everything up to the end of this slot's
+    // previous frame is done
+    if (m_frameEnd[frameSlot] > m_tail.load(std::memory_order_relaxed))
+        m_tail.store(m_frameEnd[frameSlot], std::memory_order_release);
+
+    m_currentSlot = int(frameSlot);
+}
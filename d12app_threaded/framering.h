@@ -0,0 +1,33 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include "platform.h"
+
+// Offsets into a circular buffer, handed out as contiguous pieces by bumping
+// a head and reclaimed one frame at a time. beginFrame(slot) must be called
+// once the GPU is done with the slot's previous frame, which also closes the
+// frame before it. allocate() may be called from any thread, the rest only from
+// the one driving frames.
+struct FrameRing
+{
+    static const int MAX_FRAME_SLOTS = 4; // at least FRAMES_IN_FLIGHT
+
+    void reset(UINT64 capacity);
+    // alignment is a power of two no larger than the capacity, the capacity
+    // itself does not need to be a multiple of it
+    bool allocate(UINT64 size, UINT64 alignment, UINT64 *offset);
+    void beginFrame(UINT frameSlot);
+
+    UINT64 capacity() const { return m_capacity; }
+    UINT64 used() const { return m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed); }
+
+private:
+    UINT64 m_capacity = 0;
+    // both grow without bound, the offset is the position modulo the capacity
+    std::atomic<UINT64> m_head { 0 };
+    std::atomic<UINT64> m_tail { 0 };
+    UINT64 m_frameEnd[MAX_FRAME_SLOTS] = {};
+    int m_currentSlot = -1;
+};
+
+#endif
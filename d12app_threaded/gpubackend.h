@@ -0,0 +1,63 @@
+#ifndef GPUBACKEND_H
+#define GPUBACKEND_H
+
+#include "common.h"
+
+// The device-facing calls the frame machinery (App, Builder, DescHeapMgr) makes.
+// Command lists, allocators and descriptor heaps keep their D3D12 types, but only
+// the backend may call into them; with a backend that has no device() they are
+// opaque handles and builders must not record real commands.
+struct GpuBackend
+{
+    virtual ~GpuBackend() { }
+
+    virtual bool initialize(HWND hWnd, UINT width, UINT height) = 0;
+    virtual void releaseResources() = 0;
+    virtual bool isInitialized() const = 0;
+    virtual ID3D12Device *device() const = 0; // null when there is no real device
+    virtual void queryFeatures(D3D12_FEATURE_DATA_D3D12_OPTIONS *features, D3D12_FEATURE_DATA_ARCHITECTURE *archFeatures) = 0;
+    virtual void logMemoryUsage() = 0;
+
+    virtual UINT currentBackBufferIndex() = 0;
+    virtual bool getBackBuffer(UINT index, ID3D12Resource **buffer) = 0; // AddRef'ed, may be null
+    virtual HRESULT resizeSwapchain(UINT width, UINT height) = 0;
+    virtual HRESULT present(UINT syncInterval) = 0;
+
+    virtual void executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists) = 0;
+    virtual void signalFence(UINT64 value) = 0;
+    virtual UINT64 completedFenceValue() = 0;
+    virtual void waitFence(UINT64 value) = 0;
+
+    // The copy queue runs uploads alongside the direct queue and has a fence of its own.
+    virtual void executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists) = 0;
+    virtual void signalCopyFence(UINT64 value) = 0;
+    virtual UINT64 completedCopyFenceValue() = 0;
+    virtual void waitCopyFence(UINT64 value) = 0;
+    // Makes the direct queue wait on the GPU, without blocking the caller,
+    // until the copy fence reaches value. Applies to lists executed after this.
+    virtual void queueWaitCopyFence(UINT64 value) = 0;
+
+    virtual ID3D12CommandAllocator *createCommandAllocator(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) = 0;
+    virtual void releaseCommandAllocator(ID3D12CommandAllocator *allocator) = 0;
+    virtual void resetCommandAllocator(ID3D12CommandAllocator *allocator) = 0;
+    // the list is returned closed, type must match the allocator's
+    virtual ID3D12GraphicsCommandList *createCommandList(ID3D12CommandAllocator *allocator,
+        D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) = 0;
+    virtual void releaseCommandList(ID3D12GraphicsCommandList *cmdList) = 0;
+    virtual void resetCommandList(ID3D12GraphicsCommandList *cmdList, ID3D12CommandAllocator *allocator) = 0;
+    virtual void closeCommandList(ID3D12GraphicsCommandList *cmdList) = 0;
+    virtual void resourceBarrier(ID3D12GraphicsCommandList *cmdList, const D3D12_RESOURCE_BARRIER &barrier) = 0;
+
+    virtual UINT descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE type) = 0;
+    virtual ID3D12DescriptorHeap *createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC &desc, D3D12_CPU_DESCRIPTOR_HANDLE *start,
+        D3D12_GPU_DESCRIPTOR_HANDLE *gpuStart = nullptr) = 0;
+    virtual void releaseDescriptorHeap(ID3D12DescriptorHeap *heap) = 0;
+    virtual void copyDescriptorsSimple(UINT n, D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) = 0;
+    // The source and destination ranges may be split differently, only the totals must match.
+    virtual void copyDescriptors(UINT dstRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *dstStarts, const UINT *dstSizes,
+        UINT srcRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *srcStarts, const UINT *srcSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) = 0;
+};
+
+#endif
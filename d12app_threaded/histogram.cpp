@@ -0,0 +1,64 @@
+#include "histogram.h"
+
+UINT Histogram::bucketIndex(UINT64 v)
+{
+    if (v < SUB_BUCKETS)
+        return UINT(v);
+
+    const UINT msb = bitScanReverse64(v);
+    const UINT shift = msb - SUB_BUCKET_BITS;
+    const UINT sub = UINT(v >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+UINT64 Histogram::bucketUpperBound(UINT index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+
+    const UINT shift = index / SUB_BUCKETS - 1;
+    const UINT64 sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void Histogram::record(INT64 ns)
+{
+    const UINT64 v = ns > 0 ? UINT64(ns) : 0;
+    m_buckets[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(v, std::memory_order_relaxed);
+
+    INT64 prevMax = m_max.load(std::memory_order_relaxed);
+    while (INT64(v) > prevMax && !m_max.compare_exchange_weak(prevMax, INT64(v), std::memory_order_relaxed)) { }
+}
+
+void Histogram::reset()
+{
+    for (std::atomic<UINT64> &bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+INT64 Histogram::mean() const
+{
+    const UINT64 n = count();
+    return n ? INT64(m_sum.load(std::memory_order_relaxed) / n) : 0;
+}
+
+INT64 Histogram::percentile(double p) const
+{
+    const UINT64 n = count();
+    if (!n)
+        return 0;
+
+    const UINT64 rank = (std::max)(UINT64(1), UINT64(p / 100.0 * double(n) + 0.5));
+    UINT64 seen = 0;
+    for (UINT i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return (std::min)(INT64(bucketUpperBound(i)), maxValue());
+    }
+    return maxValue();
+}
@@ -0,0 +1,33 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "platform.h"
+
+// Fixed-size log-linear histogram of durations in nanoseconds. Each power of
+// two is split into 8 sub-buckets, so values are reported within 12.5%.
+// Recording is lock-free and can happen from any thread.
+struct Histogram
+{
+    void record(INT64 ns);
+    void reset();
+
+    UINT64 count() const { return m_count.load(std::memory_order_relaxed); }
+    INT64 maxValue() const { return m_max.load(std::memory_order_relaxed); }
+    INT64 mean() const;
+    INT64 percentile(double p) const; // p in 0..100
+
+    static const UINT SUB_BUCKET_BITS = 3;
+    static const UINT SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const UINT BUCKET_COUNT = 64 * SUB_BUCKETS;
+
+private:
+    static UINT bucketIndex(UINT64 v);
+    static UINT64 bucketUpperBound(UINT index);
+
+    std::atomic<UINT64> m_buckets[BUCKET_COUNT] = {};
+    std::atomic<UINT64> m_count { 0 };
+    std::atomic<UINT64> m_sum { 0 };
+    std::atomic<INT64> m_max { 0 };
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "jobsystem.h"
+#include "trace.h"
+
+static thread_local JobSystem *t_jobSystem = nullptr;
+static thread_local UINT t_workerIndex = 0;
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::start(UINT workerCount)
+{
+    if (isStarted())
+        return;
+
+    if (!workerCount)
+        workerCount = (std::max)(1U, std::thread::hardware_concurrency());
+
+    m_stop = false;
+    m_workers.resize(workerCount);
+    for (UINT i = 0; i < workerCount; ++i)
+        m_workers[i] = new Worker;
+    for (UINT i = 0; i < workerCount; ++i)
+        m_workers[i]->thread = new std::thread(std::bind(&JobSystem::run, this, i));
+
+    log("Job system started with %u workers", workerCount);
+}
+
+void JobSystem::stop()
+{
+    if (!isStarted())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCond.notify_all();
+
+    for (Worker *w : m_workers) {
+        w->thread->join();
+        delete w->thread;
+    }
+    for (Worker *w : m_workers)
+        delete w;
+    m_workers.clear();
+}
+
+void JobSystem::submit(const Job &job)
+{
+    assert(isStarted());
+
+    // jobs spawned from a worker stay local (LIFO, cache-warm), others are spread round-robin
+    const UINT workerIndex = t_jobSystem == this ? t_workerIndex
+        : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % UINT(m_workers.size());
+
+    Worker *w = m_workers[workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(w->mutex);
+        w->jobs.push_back(job);
+    }
+
+    m_pendingJobs.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_sleepCond.notify_one();
+}
+
+bool JobSystem::pop(UINT workerIndex, Job *job)
+{
+    Worker *w = m_workers[workerIndex];
+    std::lock_guard<std::mutex> lock(w->mutex);
+    if (w->jobs.empty())
+        return false;
+
+    *job = w->jobs.back();
+    w->jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::steal(UINT thiefIndex, Job *job)
+{
+    const UINT workerCount = UINT(m_workers.size());
+    for (UINT i = 1; i < workerCount; ++i) {
+        Worker *victim = m_workers[(thiefIndex + i) % workerCount];
+        std::unique_lock<std::mutex> lock(victim->mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim->jobs.empty())
+            continue;
+
+        *job = victim->jobs.front();
+        victim->jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::run(UINT workerIndex)
+{
+    t_jobSystem = this;
+    t_workerIndex = workerIndex;
+
+    char threadName[64];
+    snprintf(threadName, sizeof(threadName), "Job worker %u", workerIndex);
+    Trace::setThreadName(threadName);
+
+    const int SPIN_COUNT = isSpinWaitUseful() ? 64 : 0;
+    int spin = 0;
+    for (; ;) {
+        Job job;
+        if (pop(workerIndex, &job) || steal(workerIndex, &job)) {
+            m_pendingJobs.fetch_sub(1);
+            job.func(job.data);
+            spin = 0;
+            continue;
+        }
+
+        if (m_pendingJobs.load() > 0 || ++spin < SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCond.wait(lock, [this] { return m_stop || m_pendingJobs.load() > 0; });
+        if (m_stop && m_pendingJobs.load() == 0)
+            break;
+        spin = 0;
+    }
+
+    t_jobSystem = nullptr;
+}
@@ -0,0 +1,41 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "platform.h"
+
+struct JobSystem
+{
+    struct Job {
+        void (*func)(void *data);
+        void *data;
+    };
+
+    ~JobSystem();
+
+    void start(UINT workerCount = 0); // 0 = one worker per hardware thread
+    void stop();
+    bool isStarted() const { return !m_workers.empty(); }
+    UINT workerCount() const { return UINT(m_workers.size()); }
+
+    void submit(const Job &job);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::thread *thread = nullptr;
+    };
+
+    void run(UINT workerIndex);
+    bool pop(UINT workerIndex, Job *job);
+    bool steal(UINT thiefIndex, Job *job);
+
+    std::vector<Worker *> m_workers;
+    std::atomic<UINT> m_nextWorker { 0 };
+    std::atomic<int> m_pendingJobs { 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCond;
+    bool m_stop = false;
+};
+
+#endif
@@ -29,6 +29,17 @@ static LRESULT CALLBACK windowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lP
     }
         return 0;
 
+    case WM_KEYDOWN:
+        if (g_app && wParam == 'S')
+            g_app->logBuildStats();
+        else if (g_app && wParam == 'D')
+            g_app->m_descHeapMgr.logStats();
+        else if (g_app && wParam == 'C')
+            g_app->compactDescriptorHeaps();
+        else if (wParam == 'T')
+            Trace::dump("trace.json");
+        return 0;
+
     case WM_MBUTTONDOWN:
         if (g_app) {
             log("Simulating graphics device loss");
@@ -71,7 +82,10 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
 
     ShowWindow(window, nCmdShow);
 
-    App app(hInstance, window, MULTITHREADED ? Builder::ThreadModel::Threaded : Builder::ThreadModel::NonThreaded);
+    Builder::ThreadModel threadModel = Builder::ThreadModel::NonThreaded;
+    if (MULTITHREADED)
+        threadModel = USE_JOB_SYSTEM ? Builder::ThreadModel::JobSystem : Builder::ThreadModel::Threaded;
+    App app(hInstance, window, threadModel);
     BuilderHost bldHost;
     app.setFrameFunc(std::bind(&BuilderHost::frame, &bldHost));
     app.addReleaseResourcesFunc(std::bind(&BuilderHost::releaseResourcesNotify, &bldHost));
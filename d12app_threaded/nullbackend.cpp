@@ -0,0 +1,281 @@
+#include "nullbackend.h"
+
+NullBackend::~NullBackend()
+{
+    releaseResources();
+}
+
+bool NullBackend::initialize(HWND, UINT width, UINT height)
+{
+    log("NullBackend::initialize() %ux%u, simulated GPU cost per command list %lld us", width, height, m_gpuCostNs / 1000);
+    m_backBufferIndex = 0;
+    m_queue.busyUntil = m_copyQueue.busyUntil = std::chrono::steady_clock::now();
+    m_initialized = true;
+    return true;
+}
+
+void NullBackend::releaseResources()
+{
+    // what was submitted is considered done, like after a device wait
+    for (Queue *queue : { &m_queue, &m_copyQueue }) {
+        if (!queue->pendingFences.empty()) {
+            queue->completedFenceValue = queue->pendingFences.back().value;
+            queue->pendingFences.clear();
+        }
+    }
+    m_initialized = false;
+}
+
+void NullBackend::queryFeatures(D3D12_FEATURE_DATA_D3D12_OPTIONS *features, D3D12_FEATURE_DATA_ARCHITECTURE *archFeatures)
+{
+    *features = {};
+    features->ResourceBindingTier = D3D12_RESOURCE_BINDING_TIER_3;
+    features->ResourceHeapTier = D3D12_RESOURCE_HEAP_TIER_2;
+    *archFeatures = {};
+}
+
+bool NullBackend::getBackBuffer(UINT, ID3D12Resource **buffer)
+{
+    *buffer = nullptr;
+    return true;
+}
+
+HRESULT NullBackend::resizeSwapchain(UINT, UINT)
+{
+    m_backBufferIndex = 0;
+    return S_OK;
+}
+
+HRESULT NullBackend::present(UINT)
+{
+    m_backBufferIndex = (m_backBufferIndex + 1) % SWAPCHAIN_BUFFER_COUNT;
+    ++m_stats.presents;
+    return S_OK;
+}
+
+void NullBackend::execute(Queue *queue, D3D12_COMMAND_LIST_TYPE type, UINT count, ID3D12CommandList *const *cmdLists)
+{
+    for (UINT i = 0; i < count; ++i) {
+        const CommandList *cmdList = reinterpret_cast<const CommandList *>(cmdLists[i]);
+        if (cmdList->open)
+            log("NullBackend: executing a command list that is not closed");
+        if (cmdList->type != type)
+            log("NullBackend: executing a command list of type %d on a queue of type %d", cmdList->type, type);
+    }
+    queue->pendingCostNs += m_gpuCostNs * count;
+}
+
+void NullBackend::signal(Queue *queue, UINT64 value)
+{
+    // the queue runs the lists back to back, starting no earlier than now
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    queue->busyUntil = (std::max)(queue->busyUntil, now) + std::chrono::nanoseconds(queue->pendingCostNs);
+    queue->pendingCostNs = 0;
+    queue->pendingFences.push_back({ value, queue->busyUntil });
+}
+
+void NullBackend::retireFences(Queue *queue, std::chrono::steady_clock::time_point now)
+{
+    while (!queue->pendingFences.empty() && queue->pendingFences.front().completion <= now) {
+        queue->completedFenceValue = queue->pendingFences.front().value;
+        queue->pendingFences.pop_front();
+    }
+}
+
+void NullBackend::waitQueueFence(Queue *queue, UINT64 value)
+{
+    retireFences(queue, std::chrono::steady_clock::now());
+    if (queue->completedFenceValue >= value)
+        return;
+
+    ++m_stats.fenceWaits;
+    for (const PendingFence &f : queue->pendingFences) {
+        if (f.value >= value) {
+            std::this_thread::sleep_until(f.completion);
+            break;
+        }
+    }
+    retireFences(queue, std::chrono::steady_clock::now());
+    if (queue->completedFenceValue < value) {
+        // waiting for a value that was never signaled would hang a real queue
+        log("NullBackend: wait for unsignaled fence value %llu", value);
+        queue->completedFenceValue = value;
+    }
+}
+
+void NullBackend::executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists)
+{
+    execute(&m_queue, D3D12_COMMAND_LIST_TYPE_DIRECT, count, cmdLists);
+    m_stats.executedCommandLists += count;
+}
+
+void NullBackend::signalFence(UINT64 value)
+{
+    signal(&m_queue, value);
+}
+
+UINT64 NullBackend::completedFenceValue()
+{
+    retireFences(&m_queue, std::chrono::steady_clock::now());
+    return m_queue.completedFenceValue;
+}
+
+void NullBackend::waitFence(UINT64 value)
+{
+    waitQueueFence(&m_queue, value);
+}
+
+void NullBackend::executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists)
+{
+    execute(&m_copyQueue, D3D12_COMMAND_LIST_TYPE_COPY, count, cmdLists);
+    m_stats.executedCopyCommandLists += count;
+}
+
+void NullBackend::signalCopyFence(UINT64 value)
+{
+    signal(&m_copyQueue, value);
+}
+
+UINT64 NullBackend::completedCopyFenceValue()
+{
+    retireFences(&m_copyQueue, std::chrono::steady_clock::now());
+    return m_copyQueue.completedFenceValue;
+}
+
+void NullBackend::waitCopyFence(UINT64 value)
+{
+    waitQueueFence(&m_copyQueue, value);
+}
+
+void NullBackend::queueWaitCopyFence(UINT64 value)
+{
+    retireFences(&m_copyQueue, std::chrono::steady_clock::now());
+    if (m_copyQueue.completedFenceValue >= value)
+        return;
+
+    const PendingFence *target = nullptr;
+    for (const PendingFence &f : m_copyQueue.pendingFences) {
+        if (f.value >= value) {
+            target = &f;
+            break;
+        }
+    }
+    if (!target) {
+        log("NullBackend: queue wait for unsignaled copy fence value %llu", value);
+        return;
+    }
+
+    // what the direct queue has so far runs before the wait, the rest after it
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    m_queue.busyUntil = (std::max)(m_queue.busyUntil, now) + std::chrono::nanoseconds(m_queue.pendingCostNs);
+    m_queue.pendingCostNs = 0;
+    if (target->completion > m_queue.busyUntil) {
+        m_queue.busyUntil = target->completion;
+        ++m_stats.queueWaits;
+    }
+}
+
+ID3D12CommandAllocator *NullBackend::createCommandAllocator(D3D12_COMMAND_LIST_TYPE type)
+{
+    CommandAllocator *allocator = new CommandAllocator;
+    allocator->type = type;
+    allocator->resetCount = 0;
+    return reinterpret_cast<ID3D12CommandAllocator *>(allocator);
+}
+
+void NullBackend::releaseCommandAllocator(ID3D12CommandAllocator *allocator)
+{
+    delete reinterpret_cast<CommandAllocator *>(allocator);
+}
+
+void NullBackend::resetCommandAllocator(ID3D12CommandAllocator *allocator)
+{
+    ++reinterpret_cast<CommandAllocator *>(allocator)->resetCount;
+}
+
+ID3D12GraphicsCommandList *NullBackend::createCommandList(ID3D12CommandAllocator *allocator, D3D12_COMMAND_LIST_TYPE type)
+{
+    if (reinterpret_cast<CommandAllocator *>(allocator)->type != type)
+        log("NullBackend: creating a command list of type %d with an allocator of type %d",
+            type, reinterpret_cast<CommandAllocator *>(allocator)->type);
+    CommandList *cmdList = new CommandList;
+    cmdList->type = type;
+    cmdList->allocator = reinterpret_cast<CommandAllocator *>(allocator);
+    cmdList->open = false;
+    cmdList->commandCount = 0;
+    return reinterpret_cast<ID3D12GraphicsCommandList *>(cmdList);
+}
+
+void NullBackend::releaseCommandList(ID3D12GraphicsCommandList *cmdList)
+{
+    delete reinterpret_cast<CommandList *>(cmdList);
+}
+
+void NullBackend::resetCommandList(ID3D12GraphicsCommandList *cmdList, ID3D12CommandAllocator *allocator)
+{
+    CommandList *l = reinterpret_cast<CommandList *>(cmdList);
+    if (l->open)
+        log("NullBackend: resetting a command list that is not closed");
+    l->allocator = reinterpret_cast<CommandAllocator *>(allocator);
+    l->open = true;
+    l->commandCount = 0;
+}
+
+void NullBackend::closeCommandList(ID3D12GraphicsCommandList *cmdList)
+{
+    reinterpret_cast<CommandList *>(cmdList)->open = false;
+}
+
+void NullBackend::resourceBarrier(ID3D12GraphicsCommandList *cmdList, const D3D12_RESOURCE_BARRIER &)
+{
+    ++reinterpret_cast<CommandList *>(cmdList)->commandCount;
+}
+
+ID3D12DescriptorHeap *NullBackend::createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC &desc, D3D12_CPU_DESCRIPTOR_HANDLE *start,
+    D3D12_GPU_DESCRIPTOR_HANDLE *gpuStart)
+{
+    DescriptorHeap *heap = new DescriptorHeap;
+    heap->desc = desc;
+    heap->data = new char[SIZE_T(desc.NumDescriptors) * HANDLE_SIZE];
+    start->ptr = SIZE_T(heap->data);
+    // any unique value will do, there is nothing to bind it to
+    if (gpuStart)
+        gpuStart->ptr = (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) ? UINT64(start->ptr) : 0;
+    return reinterpret_cast<ID3D12DescriptorHeap *>(heap);
+}
+
+void NullBackend::releaseDescriptorHeap(ID3D12DescriptorHeap *heap)
+{
+    DescriptorHeap *h = reinterpret_cast<DescriptorHeap *>(heap);
+    delete[] h->data;
+    delete h;
+}
+
+void NullBackend::copyDescriptorsSimple(UINT n, D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+    D3D12_DESCRIPTOR_HEAP_TYPE)
+{
+    memmove(reinterpret_cast<void *>(dst.ptr), reinterpret_cast<const void *>(src.ptr), SIZE_T(n) * HANDLE_SIZE);
+}
+
+void NullBackend::copyDescriptors(UINT dstRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *dstStarts, const UINT *dstSizes,
+    UINT srcRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *srcStarts, const UINT *srcSizes,
+    D3D12_DESCRIPTOR_HEAP_TYPE)
+{
+    UINT dstRange = 0, dstPos = 0;
+    UINT srcRange = 0, srcPos = 0;
+    while (dstRange < dstRangeCount && srcRange < srcRangeCount) {
+        const UINT n = (std::min)(dstSizes[dstRange] - dstPos, srcSizes[srcRange] - srcPos);
+        memmove(reinterpret_cast<void *>(dstStarts[dstRange].ptr + SIZE_T(dstPos) * HANDLE_SIZE),
+            reinterpret_cast<const void *>(srcStarts[srcRange].ptr + SIZE_T(srcPos) * HANDLE_SIZE), SIZE_T(n) * HANDLE_SIZE);
+        dstPos += n;
+        srcPos += n;
+        if (dstPos == dstSizes[dstRange]) {
+            ++dstRange;
+            dstPos = 0;
+        }
+        if (srcPos == srcSizes[srcRange]) {
+            ++srcRange;
+            srcPos = 0;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef NULLBACKEND_H
+#define NULLBACKEND_H
+
+#include "gpubackend.h"
+
+// CPU-only backend for running the builder and frame machinery headless, f.ex.
+// to benchmark App::render scaling. Command lists only track their state, the
+// "GPU" finishes each submitted list after gpuCostNs of simulated time, and
+// descriptor heaps are plain memory. The copy queue is simulated the same way.
+// There is no device(), so builders must not record real commands.
+struct NullBackend : public GpuBackend
+{
+    struct Stats {
+        UINT64 executedCommandLists;
+        UINT64 executedCopyCommandLists;
+        UINT64 queueWaits; // direct queue waits that actually stalled it
+        UINT64 presents;
+        UINT64 fenceWaits;
+    };
+
+    NullBackend(INT64 gpuCostNs = 0) : m_gpuCostNs(gpuCostNs) { }
+    ~NullBackend();
+
+    bool initialize(HWND hWnd, UINT width, UINT height) override;
+    void releaseResources() override;
+    bool isInitialized() const override { return m_initialized; }
+    ID3D12Device *device() const override { return nullptr; }
+    void queryFeatures(D3D12_FEATURE_DATA_D3D12_OPTIONS *features, D3D12_FEATURE_DATA_ARCHITECTURE *archFeatures) override;
+    void logMemoryUsage() override { }
+
+    UINT currentBackBufferIndex() override { return m_backBufferIndex; }
+    bool getBackBuffer(UINT index, ID3D12Resource **buffer) override;
+    HRESULT resizeSwapchain(UINT width, UINT height) override;
+    HRESULT present(UINT syncInterval) override;
+
+    void executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override;
+    void signalFence(UINT64 value) override;
+    UINT64 completedFenceValue() override;
+    void waitFence(UINT64 value) override;
+
+    void executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override;
+    void signalCopyFence(UINT64 value) override;
+    UINT64 completedCopyFenceValue() override;
+    void waitCopyFence(UINT64 value) override;
+    void queueWaitCopyFence(UINT64 value) override;
+
+    ID3D12CommandAllocator *createCommandAllocator(D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) override;
+    void releaseCommandAllocator(ID3D12CommandAllocator *allocator) override;
+    void resetCommandAllocator(ID3D12CommandAllocator *allocator) override;
+    ID3D12GraphicsCommandList *createCommandList(ID3D12CommandAllocator *allocator,
+        D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT) override;
+    void releaseCommandList(ID3D12GraphicsCommandList *cmdList) override;
+    void resetCommandList(ID3D12GraphicsCommandList *cmdList, ID3D12CommandAllocator *allocator) override;
+    void closeCommandList(ID3D12GraphicsCommandList *cmdList) override;
+    void resourceBarrier(ID3D12GraphicsCommandList *cmdList, const D3D12_RESOURCE_BARRIER &barrier) override;
+
+    UINT descriptorHandleSize(D3D12_DESCRIPTOR_HEAP_TYPE) override { return HANDLE_SIZE; }
+    ID3D12DescriptorHeap *createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC &desc, D3D12_CPU_DESCRIPTOR_HANDLE *start,
+        D3D12_GPU_DESCRIPTOR_HANDLE *gpuStart = nullptr) override;
+    void releaseDescriptorHeap(ID3D12DescriptorHeap *heap) override;
+    void copyDescriptorsSimple(UINT n, D3D12_CPU_DESCRIPTOR_HANDLE dst, D3D12_CPU_DESCRIPTOR_HANDLE src,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+    void copyDescriptors(UINT dstRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *dstStarts, const UINT *dstSizes,
+        UINT srcRangeCount, const D3D12_CPU_DESCRIPTOR_HANDLE *srcStarts, const UINT *srcSizes,
+        D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+
+    const Stats &stats() const { return m_stats; }
+
+    static const UINT HANDLE_SIZE = 32;
+
+private:
+    struct CommandAllocator {
+        D3D12_COMMAND_LIST_TYPE type;
+        UINT64 resetCount;
+    };
+    struct CommandList {
+        D3D12_COMMAND_LIST_TYPE type;
+        CommandAllocator *allocator;
+        bool open;
+        UINT commandCount;
+    };
+    struct DescriptorHeap {
+        D3D12_DESCRIPTOR_HEAP_DESC desc;
+        char *data;
+    };
+    struct PendingFence {
+        UINT64 value;
+        std::chrono::steady_clock::time_point completion;
+    };
+
+    struct Queue {
+        INT64 pendingCostNs = 0; // executed since the last signal
+        std::chrono::steady_clock::time_point busyUntil;
+        std::deque<PendingFence> pendingFences;
+        UINT64 completedFenceValue = 0;
+    };
+
+    void execute(Queue *queue, D3D12_COMMAND_LIST_TYPE type, UINT count, ID3D12CommandList *const *cmdLists);
+    static void signal(Queue *queue, UINT64 value);
+    static void retireFences(Queue *queue, std::chrono::steady_clock::time_point now);
+    void waitQueueFence(Queue *queue, UINT64 value);
+
+    INT64 m_gpuCostNs;
+    bool m_initialized = false;
+    UINT m_backBufferIndex = 0;
+    Queue m_queue;
+    Queue m_copyQueue;
+    Stats m_stats = {};
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "platform.h"
+#include <stdarg.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#ifndef _MSC_VER
+#include <cxxabi.h>
+#endif
+
+void log(const char *fmt, ...)
+{
+    char msg[512];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(msg, sizeof(msg) - 1, fmt, args);
+    va_end(args);
+    const size_t end = len < 0 ? 0 : (std::min)(size_t(len), sizeof(msg) - 2);
+    msg[end] = '\n';
+    msg[end + 1] = '\0';
+
+#ifdef _WIN32
+    OutputDebugStringA(msg);
+#else
+    fputs(msg, stderr);
+#endif
+}
+
+const char *typeName(const std::type_info &type)
+{
+#ifdef _MSC_VER
+    // already readable, only "struct " or "class " in front
+    const char *name = type.name();
+    for (const char *prefix : { "struct ", "class " }) {
+        const size_t len = strlen(prefix);
+        if (!strncmp(name, prefix, len))
+            return name + len;
+    }
+    return name;
+#else
+    static std::mutex mutex;
+    static std::map<std::type_index, std::string> names;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = names.find(type);
+    if (it == names.end()) {
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        it = names.emplace(type, status == 0 && demangled ? demangled : type.name()).first;
+        free(demangled);
+    }
+    return it->second.c_str();
+#endif
+}
+
+#ifdef _WIN32
+
+WaitEvent::WaitEvent()
+{
+    m_handle = CreateEvent(nullptr, false, false, nullptr);
+}
+
+WaitEvent::~WaitEvent()
+{
+    CloseHandle(m_handle);
+}
+
+void WaitEvent::set()
+{
+    SetEvent(m_handle);
+}
+
+void WaitEvent::wait()
+{
+    WaitForSingleObject(m_handle, INFINITE);
+}
+
+UINT32 currentThreadId()
+{
+    return GetCurrentThreadId();
+}
+
+FILE *openFileForWriting(const char *filename)
+{
+    FILE *f = nullptr;
+    if (fopen_s(&f, filename, "w"))
+        return nullptr;
+    return f;
+}
+
+#else
+
+WaitEvent::WaitEvent()
+{
+}
+
+WaitEvent::~WaitEvent()
+{
+}
+
+void WaitEvent::set()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_signaled = true;
+    }
+    m_cond.notify_one();
+}
+
+void WaitEvent::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return m_signaled; });
+    m_signaled = false;
+}
+
+UINT32 currentThreadId()
+{
+    return UINT32(syscall(SYS_gettid));
+}
+
+FILE *openFileForWriting(const char *filename)
+{
+    return fopen(filename, "w");
+}
+
+#endif
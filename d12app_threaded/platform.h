@@ -0,0 +1,128 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// OS-facing basics for the threading and scheduling code. Whatever includes
+// only this header (and not common.h) builds without windows.h or D3D12.
+// common.h falls back to the declarations in d3d12headless.h elsewhere.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+typedef unsigned int UINT;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+typedef size_t SIZE_T;
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <typeinfo>
+#include <typeindex>
+#include <string>
+
+void log(const char *fmt, ...);
+
+// Auto-reset event, same semantics as CreateEvent(nullptr, false, false, nullptr).
+struct WaitEvent
+{
+    WaitEvent();
+    ~WaitEvent();
+    WaitEvent(const WaitEvent &) = delete;
+    WaitEvent &operator=(const WaitEvent &) = delete;
+
+    void set();
+    void wait();
+
+private:
+#ifdef _WIN32
+    HANDLE m_handle;
+#else
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_signaled = false;
+#endif
+};
+
+// the caller of the function this is used in
+#ifdef _MSC_VER
+#define RETURN_ADDRESS() _ReturnAddress()
+#else
+#define RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+inline void cpuRelax()
+{
+#ifdef _WIN32
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Whether spinning before blocking can pay off. With a single hardware thread
+// the spinner only keeps whoever it waits for off the CPU, often until the
+// next scheduler tick.
+inline bool isSpinWaitUseful()
+{
+    static const bool useful = std::thread::hardware_concurrency() > 1;
+    return useful;
+}
+
+UINT32 currentThreadId();
+FILE *openFileForWriting(const char *filename);
+// type.name() in readable form, demangled where the ABI mangles it. The
+// string lives as long as the process.
+const char *typeName(const std::type_info &type);
+
+// v must not be 0
+inline UINT bitScanForward64(UINT64 v)
+{
+#ifdef _WIN32
+    DWORD index;
+    _BitScanForward64(&index, v);
+    return index;
+#else
+    return UINT(__builtin_ctzll(v));
+#endif
+}
+
+inline UINT bitScanReverse64(UINT64 v)
+{
+#ifdef _WIN32
+    DWORD index;
+    _BitScanReverse64(&index, v);
+    return index;
+#else
+    return UINT(63 - __builtin_clzll(v));
+#endif
+}
+
+inline UINT popCount64(UINT64 v)
+{
+#ifdef _WIN32
+    return UINT(__popcnt64(v));
+#else
+    return UINT(__builtin_popcountll(v));
+#endif
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "readbackring.h"
+#include "res.h"
+
+bool ReadbackRing::initialize(ID3D12Device *dev, UINT64 capacity, JobSystem *jobSystem)
+{
+    m_jobSystem = jobSystem;
+    m_buffer = Res::createBuffer(dev, Res::Storage::DeviceToHost, capacity);
+    if (!m_buffer)
+        return false;
+
+    const D3D12_RANGE readRange = { 0, SIZE_T(capacity) };
+    void *p = nullptr;
+    HRESULT hr = m_buffer->Map(0, &readRange, &p);
+    if (FAILED(hr)) {
+        logHr("Failed to map readback ring buffer", hr);
+        Res::releaseResource(m_buffer);
+        m_buffer = nullptr;
+        return false;
+    }
+
+    m_cpuStart = static_cast<const char *>(p);
+    m_ring.reset(capacity);
+    m_frameSlot = 0;
+    m_frameFenceValue = 0;
+    return true;
+}
+
+void ReadbackRing::releaseResources()
+{
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending.empty())
+            log("Dropping %llu readback callbacks", UINT64(m_pending.size()));
+        m_pending.clear();
+    }
+    if (m_buffer) {
+        const D3D12_RANGE noWrite = {};
+        m_buffer->Unmap(0, &noWrite);
+        Res::releaseResource(m_buffer);
+        m_buffer = nullptr;
+    }
+    m_cpuStart = nullptr;
+    m_ring.reset(0);
+    m_jobSystem = nullptr;
+}
+
+bool ReadbackRing::allocate(UINT64 size, UINT64 alignment, Callback callback, Allocation *allocation)
+{
+    if (!m_buffer)
+        return false;
+
+    UINT64 offset;
+    if (!m_ring.allocate(size, alignment, &offset)) {
+        log("Readback ring is full (%llu used, %llu requested)", m_ring.used(), size);
+        return false;
+    }
+    allocation->buffer = m_buffer;
+    allocation->offset = offset;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back({ m_frameSlot, m_frameFenceValue, offset, size, callback });
+    return true;
+}
+
+bool ReadbackRing::readbackBuffer(ID3D12GraphicsCommandList *cmdList, ID3D12Resource *src, UINT64 srcOffset, UINT64 size, Callback callback)
+{
+    Allocation allocation;
+    if (!allocate(size, 16, callback, &allocation))
+        return false;
+    cmdList->CopyBufferRegion(allocation.buffer, allocation.offset, src, srcOffset, size);
+    return true;
+}
+
+void ReadbackRing::runCallback(void *data)
+{
+    Completion *c = static_cast<Completion *>(data);
+    c->callback(c->data, c->size);
+    ReadbackRing *ring = c->ring;
+    {
+        std::lock_guard<std::mutex> lock(ring->m_mutex);
+        --ring->m_runningCallbacks[c->frameSlot];
+    }
+    ring->m_callbacksDone.notify_all();
+    delete c;
+}
+
+void ReadbackRing::dispatchCompleted(UINT64 completedFenceValue)
+{
+    std::vector<Completion *> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t kept = 0;
+        for (size_t i = 0; i < m_pending.size(); ++i) {
+            Pending &p(m_pending[i]);
+            if (p.fenceValue <= completedFenceValue) {
+                completions.push_back(new Completion { this, p.frameSlot, m_cpuStart + p.offset, p.size, std::move(p.callback) });
+                ++m_runningCallbacks[p.frameSlot];
+            } else if (kept++ != i) {
+                m_pending[kept - 1] = std::move(p);
+            }
+        }
+        m_pending.resize(kept);
+    }
+
+    for (Completion *c : completions) {
+        if (m_jobSystem && m_jobSystem->isStarted())
+            m_jobSystem->submit({ &ReadbackRing::runCallback, c });
+        else
+            runCallback(c);
+    }
+}
+
+void ReadbackRing::beginFrame(UINT frameSlot, UINT64 frameFenceValue, UINT64 completedFenceValue)
+{
+    if (!m_buffer)
+        return;
+
+    dispatchCompleted(completedFenceValue);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_callbacksDone.wait(lock, [this, frameSlot] { return m_runningCallbacks[frameSlot] == 0; });
+
+        // only a frame that was built but never submitted leaves anything
+        // behind here, its space is about to be reused
+        size_t kept = 0;
+        for (size_t i = 0; i < m_pending.size(); ++i) {
+            if (m_pending[i].frameSlot != frameSlot && kept++ != i)
+                m_pending[kept - 1] = std::move(m_pending[i]);
+        }
+        m_pending.resize(kept);
+    }
+
+    m_ring.beginFrame(frameSlot);
+    m_frameSlot = frameSlot;
+    m_frameFenceValue = frameFenceValue;
+}
+
+void ReadbackRing::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_callbacksDone.wait(lock, [this] {
+        for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+            if (m_runningCallbacks[i])
+                return false;
+        }
+        return true;
+    });
+}
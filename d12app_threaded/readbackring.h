@@ -0,0 +1,74 @@
+#ifndef READBACKRING_H
+#define READBACKRING_H
+
+#include "common.h"
+#include "framering.h"
+#include "jobsystem.h"
+
+// One large readback heap buffer, mapped for its whole lifetime, that GPU
+// results are copied into. Each allocation comes with a callback that runs on
+// a JobSystem worker once the fence of the frame it was allocated in has
+// passed, and gets a pointer straight into the mapped buffer. Space is
+// reclaimed per frame slot like with the UploadRing, but only after the slot's
+// callbacks have returned, so keep them short and copy out what is needed later.
+// The buffer is committed for the same reason as the UploadRing's.
+struct ReadbackRing
+{
+    struct Allocation {
+        ID3D12Resource *buffer;
+        UINT64 offset; // in buffer
+    };
+    // data is only valid during the call
+    using Callback = std::function<void(const void *data, UINT64 size)>;
+
+    // Without a started jobSystem the callbacks run on the thread dispatching them.
+    bool initialize(ID3D12Device *dev, UINT64 capacity, JobSystem *jobSystem);
+    void releaseResources();
+    bool isInitialized() const { return m_buffer != nullptr; }
+
+    // Thread-safe. alignment is a power of two, f.ex.
+    // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT for texture copies.
+    bool allocate(UINT64 size, UINT64 alignment, Callback callback, Allocation *allocation);
+    // Records a copy from src, which must be in the COPY_SOURCE state, into new space on cmdList.
+    bool readbackBuffer(ID3D12GraphicsCommandList *cmdList, ID3D12Resource *src, UINT64 srcOffset, UINT64 size, Callback callback);
+
+    // The rest is for the thread driving frames. frameFenceValue is what the
+    // frame starting in frameSlot will signal.
+    void beginFrame(UINT frameSlot, UINT64 frameFenceValue, UINT64 completedFenceValue);
+    void dispatchCompleted(UINT64 completedFenceValue);
+    void waitIdle();
+
+    UINT64 capacity() const { return m_ring.capacity(); }
+    UINT64 used() const { return m_ring.used(); }
+
+    struct Pending {
+        UINT frameSlot;
+        UINT64 fenceValue;
+        UINT64 offset;
+        UINT64 size;
+        Callback callback;
+    };
+    struct Completion {
+        ReadbackRing *ring;
+        UINT frameSlot;
+        const void *data;
+        UINT64 size;
+        Callback callback;
+    };
+
+    JobSystem *m_jobSystem = nullptr;
+    ID3D12Resource *m_buffer = nullptr;
+    const char *m_cpuStart = nullptr;
+    FrameRing m_ring;
+    UINT m_frameSlot = 0;
+    UINT64 m_frameFenceValue = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_callbacksDone;
+    std::vector<Pending> m_pending;
+    int m_runningCallbacks[FRAMES_IN_FLIGHT] = {};
+
+private:
+    static void runCallback(void *data);
+};
+
+#endif
@@ -27,20 +27,43 @@ DXGI_SAMPLE_DESC makeSampleDesc(ID3D12Device *dev, DXGI_FORMAT format, UINT samp
     return sampleDesc;
 }
 
-ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT width, UINT height, UINT samples)
+static ID3D12Resource *createResource(ID3D12Device *dev, D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC &desc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue, ResHeapAllocator *allocator)
+{
+    if (allocator && allocator->isInitialized())
+        return allocator->createResource(heapType, desc, initialState, clearValue);
+
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type = heapType;
+    ID3D12Resource *resource = nullptr;
+    if (FAILED(dev->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+        initialState, clearValue, IID_ID3D12Resource, reinterpret_cast<void **>(&resource))))
+    {
+        return nullptr;
+    }
+    return resource;
+}
+
+void releaseResource(ID3D12Resource *resource, ResHeapAllocator *allocator)
+{
+    if (allocator)
+        allocator->releaseResource(resource);
+    else if (resource)
+        resource->Release();
+}
+
+ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT width, UINT height, UINT samples,
+    ResHeapAllocator *allocator)
 {
     D3D12_CLEAR_VALUE depthClearValue = {};
     depthClearValue.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
     depthClearValue.DepthStencil.Depth = 1.0f;
     depthClearValue.DepthStencil.Stencil = 0;
 
-    D3D12_HEAP_PROPERTIES heapProp = {};
-    heapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
-
     D3D12_RESOURCE_DESC desc = {};
     desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    desc.Width = max(1U, width);
-    desc.Height = max(1U, height);
+    desc.Width = (std::max)(1U, width);
+    desc.Height = (std::max)(1U, height);
     desc.DepthOrArraySize = 1;
     desc.MipLevels = 1;
     desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
@@ -48,11 +71,9 @@ ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDL
     desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
     desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
 
-    ID3D12Resource *resource = nullptr;
-    if (FAILED(dev->CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &desc,
-        D3D12_RESOURCE_STATE_DEPTH_WRITE, &depthClearValue,
-        IID_ID3D12Resource, reinterpret_cast<void **>(&resource))))
-    {
+    ID3D12Resource *resource = createResource(dev, D3D12_HEAP_TYPE_DEFAULT, desc,
+        D3D12_RESOURCE_STATE_DEPTH_WRITE, &depthClearValue, allocator);
+    if (!resource) {
         log("Failed to create depth-stencil buffer of size %ux%u", width, height);
         return nullptr;
     }
@@ -66,28 +87,29 @@ ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDL
     return resource;
 }
 
-ID3D12Resource *createBuffer(ID3D12Device *dev, Storage type, UINT64 size, D3D12_RESOURCE_FLAGS resourceFlags)
+ID3D12Resource *createBuffer(ID3D12Device *dev, Storage type, UINT64 size, D3D12_RESOURCE_FLAGS resourceFlags,
+    ResHeapAllocator *allocator)
 {
-    D3D12_HEAP_PROPERTIES heapProps = {};
+    D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_DEFAULT;
     D3D12_RESOURCE_STATES initialState = {};
     switch (type) {
     case Storage::Device:
-        heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+        heapType = D3D12_HEAP_TYPE_DEFAULT;
         initialState = D3D12_RESOURCE_STATE_COMMON;
         break;
     case Storage::HostToDevice:
-        heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+        heapType = D3D12_HEAP_TYPE_UPLOAD;
         initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
         break;
     case Storage::DeviceToHost:
-        heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+        heapType = D3D12_HEAP_TYPE_READBACK;
         initialState = D3D12_RESOURCE_STATE_COPY_DEST;
         break;
     }
 
     D3D12_RESOURCE_DESC desc = {};
     desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    desc.Width = max(1LLU, size);
+    desc.Width = (std::max)(UINT64(1), size);
     desc.Height = 1;
     desc.DepthOrArraySize = 1;
     desc.MipLevels = 1;
@@ -96,11 +118,9 @@ ID3D12Resource *createBuffer(ID3D12Device *dev, Storage type, UINT64 size, D3D12
     desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
     desc.Flags = resourceFlags;
 
-    ID3D12Resource *buf = nullptr;
-    HRESULT hr = dev->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc,
-        initialState, nullptr, IID_PPV_ARGS(&buf));
-    if (FAILED(hr)) {
-        log("Failed to create buffer resoure", hr);
+    ID3D12Resource *buf = createResource(dev, heapType, desc, initialState, nullptr, allocator);
+    if (!buf) {
+        log("Failed to create buffer resource of size %llu", size);
         return nullptr;
     }
 
@@ -121,11 +141,35 @@ void transitionResource(ID3D12Resource *resource, ID3D12GraphicsCommandList *com
 
 ID3D12RootSignature *createRootSignature(ID3D12Device *dev,
     UINT paramCount, const D3D12_ROOT_PARAMETER *params,
-    UINT staticSamplerCount, const D3D12_STATIC_SAMPLER_DESC *staticSamplers)
+    UINT staticSamplerCount, const D3D12_STATIC_SAMPLER_DESC *staticSamplers,
+    BindlessLayout bindless)
 {
+    std::vector<D3D12_ROOT_PARAMETER> allParams(params, params + paramCount);
+    D3D12_DESCRIPTOR_RANGE ranges[3];
+    if (bindless != BindlessLayout::None) {
+        const D3D12_DESCRIPTOR_RANGE_TYPE rangeTypes[3] = {
+            D3D12_DESCRIPTOR_RANGE_TYPE_SRV, D3D12_DESCRIPTOR_RANGE_TYPE_CBV, D3D12_DESCRIPTOR_RANGE_TYPE_UAV
+        };
+        const UINT spaces[3] = { BINDLESS_SRV_SPACE, BINDLESS_CBV_SPACE, BINDLESS_UAV_SPACE };
+        const UINT rangeCount = bindless == BindlessLayout::Srv ? 1 : 3;
+        for (UINT i = 0; i < rangeCount; ++i) {
+            ranges[i].RangeType = rangeTypes[i];
+            ranges[i].NumDescriptors = UINT_MAX; // unbounded
+            ranges[i].BaseShaderRegister = 0;
+            ranges[i].RegisterSpace = spaces[i];
+            ranges[i].OffsetInDescriptorsFromTableStart = 0; // the ranges alias each other
+        }
+        D3D12_ROOT_PARAMETER tableParam = {};
+        tableParam.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        tableParam.DescriptorTable.NumDescriptorRanges = rangeCount;
+        tableParam.DescriptorTable.pDescriptorRanges = ranges;
+        tableParam.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        allParams.push_back(tableParam);
+    }
+
     D3D12_ROOT_SIGNATURE_DESC desc = {};
-    desc.NumParameters = paramCount;
-    desc.pParameters = params;
+    desc.NumParameters = UINT(allParams.size());
+    desc.pParameters = allParams.data();
     desc.NumStaticSamplers = staticSamplerCount;
     desc.pStaticSamplers = staticSamplers;
     desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
@@ -2,24 +2,43 @@
 #define RES_H
 
 #include "common.h"
+#include "resheap.h"
 
 namespace Res {
 
 DXGI_SAMPLE_DESC makeSampleDesc(ID3D12Device *dev, DXGI_FORMAT format, UINT samples);
-ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT width, UINT height, UINT samples);
+// With an initialized allocator the resources are placed into its heaps, release them with releaseResource().
+ID3D12Resource *createDepthStencil(ID3D12Device *dev, D3D12_CPU_DESCRIPTOR_HANDLE dsv, UINT width, UINT height, UINT samples,
+    ResHeapAllocator *allocator = nullptr);
 
 enum class Storage {
     Device,
     HostToDevice,
     DeviceToHost
 };
-ID3D12Resource *createBuffer(ID3D12Device *dev, Storage type, UINT64 size, D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE);
+ID3D12Resource *createBuffer(ID3D12Device *dev, Storage type, UINT64 size, D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE,
+    ResHeapAllocator *allocator = nullptr);
+void releaseResource(ID3D12Resource *resource, ResHeapAllocator *allocator = nullptr);
 
 void transitionResource(ID3D12Resource *resource, ID3D12GraphicsCommandList *commandList, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
 
+// Anything but None appends a descriptor table parameter, after params, for
+// the BindlessTable: unbounded arrays all starting at index 0 of the table,
+// SRVs in BINDLESS_SRV_SPACE and with SrvCbvUav also CBVs and UAVs in their
+// own spaces. Srv needs resource binding tier 2, SrvCbvUav tier 3.
+enum class BindlessLayout {
+    None,
+    Srv,
+    SrvCbvUav
+};
+const UINT BINDLESS_SRV_SPACE = 1;
+const UINT BINDLESS_CBV_SPACE = 2;
+const UINT BINDLESS_UAV_SPACE = 3;
+
 ID3D12RootSignature *createRootSignature(ID3D12Device *dev,
     UINT paramCount, const D3D12_ROOT_PARAMETER *params,
-    UINT staticSamplerCount = 0, const D3D12_STATIC_SAMPLER_DESC *staticSamplers = nullptr);
+    UINT staticSamplerCount = 0, const D3D12_STATIC_SAMPLER_DESC *staticSamplers = nullptr,
+    BindlessLayout bindless = BindlessLayout::None);
 
 ID3D12PipelineState *createSimplePso(ID3D12Device *dev,
     ID3D12RootSignature *rootSig,
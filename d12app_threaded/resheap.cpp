@@ -0,0 +1,153 @@
+#include "resheap.h"
+
+// smallest placement granularity, the alignment of buffers and of most textures
+static const UINT64 MIN_BLOCK_SIZE = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+bool ResHeapAllocator::initialize(ID3D12Device *dev, D3D12_RESOURCE_HEAP_TIER tier, UINT64 heapSize)
+{
+    if (heapSize < D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT || (heapSize & (heapSize - 1))) {
+        log("Resource heap size %llu is not a power of two of at least 4 MB", heapSize);
+        return false;
+    }
+    m_device = dev;
+    m_tier = tier;
+    m_heapSize = heapSize;
+    return true;
+}
+
+void ResHeapAllocator::releaseResources()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_placements.empty())
+        log("%llu placed resources still alive when releasing the resource heaps", UINT64(m_placements.size()));
+    for (Heap *heap : m_heaps) {
+        heap->heap->Release();
+        delete heap;
+    }
+    m_heaps.clear();
+    m_placements.clear();
+    m_device = nullptr;
+}
+
+ResHeapAllocator::Category ResHeapAllocator::categoryFor(const D3D12_RESOURCE_DESC &desc) const
+{
+    if (m_tier >= D3D12_RESOURCE_HEAP_TIER_2)
+        return AnyResource;
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return Buffer;
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return RtDsTexture;
+    return Texture;
+}
+
+ResHeapAllocator::Heap *ResHeapAllocator::createHeap(D3D12_HEAP_TYPE type, Category category)
+{
+    static const D3D12_HEAP_FLAGS categoryFlags[] = {
+        D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+    };
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = m_heapSize;
+    heapDesc.Properties.Type = type;
+    // MSAA render targets need 4 MB, the rest makes do with 64 KB
+    heapDesc.Alignment = category == AnyResource || category == RtDsTexture
+        ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = categoryFlags[category];
+
+    ID3D12Heap *d3dHeap = nullptr;
+    HRESULT hr = m_device->CreateHeap(&heapDesc, IID_ID3D12Heap, reinterpret_cast<void **>(&d3dHeap));
+    if (FAILED(hr)) {
+        logHr("Failed to create resource heap", hr);
+        return nullptr;
+    }
+
+    Heap *heap = new Heap;
+    heap->type = type;
+    heap->category = category;
+    heap->heap = d3dHeap;
+    heap->blocks.initialize(m_heapSize, MIN_BLOCK_SIZE);
+    m_heaps.push_back(heap);
+    return heap;
+}
+
+ID3D12Resource *ResHeapAllocator::createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC &desc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue)
+{
+    const D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+    const Category category = categoryFor(desc);
+
+    Heap *heap = nullptr;
+    UINT64 offset = 0;
+    if (info.SizeInBytes <= m_heapSize && info.Alignment <= D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Heap *h : m_heaps) {
+            if (h->type == heapType && h->category == category && h->blocks.allocate(info.SizeInBytes, info.Alignment, &offset)) {
+                heap = h;
+                break;
+            }
+        }
+        if (!heap) {
+            heap = createHeap(heapType, category);
+            if (heap && !heap->blocks.allocate(info.SizeInBytes, info.Alignment, &offset))
+                heap = nullptr;
+        }
+    }
+
+    ID3D12Resource *resource = nullptr;
+    if (heap) {
+        HRESULT hr = m_device->CreatePlacedResource(heap->heap, offset, &desc, initialState, clearValue,
+            IID_ID3D12Resource, reinterpret_cast<void **>(&resource));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (SUCCEEDED(hr)) {
+            m_placements[resource] = { heap, offset };
+            ++m_placedCount;
+            return resource;
+        }
+        logHr("Failed to create placed resource", hr);
+        heap->blocks.release(offset);
+    }
+
+    D3D12_HEAP_PROPERTIES heapProps = {};
+    heapProps.Type = heapType;
+    HRESULT hr = m_device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &desc, initialState, clearValue,
+        IID_ID3D12Resource, reinterpret_cast<void **>(&resource));
+    if (FAILED(hr)) {
+        logHr("Failed to create committed resource", hr);
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_committedCount;
+    return resource;
+}
+
+void ResHeapAllocator::releaseResource(ID3D12Resource *resource)
+{
+    if (!resource)
+        return;
+
+    // under the lock, so that a new resource at the same address cannot be recorded in between
+    std::lock_guard<std::mutex> lock(m_mutex);
+    resource->Release();
+    auto it = m_placements.find(resource);
+    if (it == m_placements.end())
+        return;
+    it->second.heap->blocks.release(it->second.offset);
+    m_placements.erase(it);
+}
+
+void ResHeapAllocator::logStats()
+{
+    static const char *heapTypeNames[] = { "?", "default", "upload", "readback", "custom" };
+    static const char *categoryNames[] = { "any", "buffers", "textures", "RT/DS textures" };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    log("Resource heaps: %llu placed resources created, %llu committed, %llu alive in %llu heaps of %llu KB",
+        m_placedCount, m_committedCount, UINT64(m_placements.size()), UINT64(m_heaps.size()), m_heapSize / 1024);
+    for (const Heap *heap : m_heaps) {
+        log("  %s heap for %s: used %llu KB largest free block %llu KB",
+            heapTypeNames[heap->type], categoryNames[heap->category],
+            heap->blocks.used() / 1024, heap->blocks.largestFreeBlock() / 1024);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef RESHEAP_H
+#define RESHEAP_H
+
+#include "common.h"
+#include "buddyallocator.h"
+
+// Places resources into large ID3D12Heaps with CreatePlacedResource instead of
+// giving each its own committed resource. Heaps are kept per heap type, and
+// with resource heap tier 1 also per resource category, since such heaps may
+// only hold one of buffers, non-RT/DS textures or RT/DS textures. Anything
+// larger than a heap is created as a committed resource. Thread-safe.
+struct ResHeapAllocator
+{
+    bool initialize(ID3D12Device *dev, D3D12_RESOURCE_HEAP_TIER tier, UINT64 heapSize);
+    void releaseResources();
+    bool isInitialized() const { return m_device != nullptr; }
+
+    ID3D12Resource *createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC &desc,
+        D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue = nullptr);
+    // Releases the resource and, if it was placed, returns its memory to the
+    // heap, so this must only happen once the GPU is done with it. Committed
+    // resources, placed or not, can be passed too.
+    void releaseResource(ID3D12Resource *resource);
+
+    void logStats();
+
+    enum Category {
+        AnyResource, // tier 2
+        Buffer,
+        Texture,
+        RtDsTexture
+    };
+    struct Heap {
+        D3D12_HEAP_TYPE type;
+        Category category;
+        ID3D12Heap *heap;
+        BuddyAllocator blocks;
+    };
+    struct Placement {
+        Heap *heap;
+        UINT64 offset;
+    };
+
+    ID3D12Device *m_device = nullptr;
+    D3D12_RESOURCE_HEAP_TIER m_tier = D3D12_RESOURCE_HEAP_TIER_1;
+    UINT64 m_heapSize = 0;
+    std::mutex m_mutex;
+    std::vector<Heap *> m_heaps;
+    std::map<ID3D12Resource *, Placement> m_placements;
+    UINT64 m_placedCount = 0;
+    UINT64 m_committedCount = 0;
+
+private:
+    Category categoryFor(const D3D12_RESOURCE_DESC &desc) const;
+    Heap *createHeap(D3D12_HEAP_TYPE type, Category category);
+};
+
+#endif
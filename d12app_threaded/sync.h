@@ -0,0 +1,152 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "platform.h"
+
+// Bounded, allocation-free multi-producer single-consumer queue. The consumer
+// spins for a while before parking on an event, and producers only make
+// the kernel call when the consumer is actually parked.
+template<typename T, UINT CAPACITY>
+struct Mailbox
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Mailbox capacity must be a power of two");
+
+    Mailbox()
+    {
+        for (UINT i = 0; i < CAPACITY; ++i)
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool tryPost(const T &msg)
+    {
+        UINT pos = m_tail.load(std::memory_order_relaxed);
+        for (; ;) {
+            Cell &cell = m_cells[pos & (CAPACITY - 1)];
+            const UINT seq = cell.seq.load(std::memory_order_acquire);
+            const int diff = int(seq - pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.msg = msg;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void post(const T &msg, WaitEvent *parkEvent = nullptr)
+    {
+        while (!tryPost(msg))
+            std::this_thread::yield();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parkEvent && m_parked.load(std::memory_order_relaxed))
+            parkEvent->set();
+    }
+
+    // consumer side
+    bool tryTake(T *msg)
+    {
+        Cell &cell = m_cells[m_head & (CAPACITY - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != m_head + 1)
+            return false;
+        *msg = cell.msg;
+        cell.seq.store(m_head + CAPACITY, std::memory_order_release);
+        ++m_head;
+        return true;
+    }
+
+    void take(T *msg, WaitEvent *parkEvent)
+    {
+        for (int spin = isSpinWaitUseful() ? SPIN_COUNT : 0; spin > 0; --spin) {
+            if (tryTake(msg))
+                return;
+            cpuRelax();
+        }
+        for (; ;) {
+            m_parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tryTake(msg)) {
+                m_parked.store(false, std::memory_order_relaxed);
+                return;
+            }
+            parkEvent->wait();
+            m_parked.store(false, std::memory_order_relaxed);
+            if (tryTake(msg))
+                return;
+        }
+    }
+
+    bool isEmpty() const
+    {
+        return m_cells[m_head & (CAPACITY - 1)].seq.load(std::memory_order_acquire) != m_head + 1;
+    }
+
+    static const int SPIN_COUNT = 4000;
+
+private:
+    struct Cell {
+        std::atomic<UINT> seq;
+        T msg;
+    };
+    Cell m_cells[CAPACITY];
+    std::atomic<UINT> m_tail { 0 };
+    UINT m_head = 0;
+    std::atomic<bool> m_parked { false };
+};
+
+// Completion counter that any number of threads count down and one thread
+// waits on. There is no limit on the fan-in.
+struct Latch
+{
+    Latch() { }
+    Latch(const Latch &) = delete;
+    Latch &operator=(const Latch &) = delete;
+
+    void arm(int count)
+    {
+        m_count.store(count, std::memory_order_relaxed);
+        m_done.store(count <= 0, std::memory_order_relaxed);
+    }
+
+    void countDown()
+    {
+        if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_event.set();
+            // last access; the latch may be destroyed as soon as the waiter sees this
+            m_done.store(true, std::memory_order_release);
+        }
+    }
+
+    bool isDone() const { return m_done.load(std::memory_order_acquire); }
+
+    void wait()
+    {
+        for (int spin = isSpinWaitUseful() ? SPIN_COUNT : 0; spin > 0; --spin) {
+            if (isDone())
+                return;
+            cpuRelax();
+        }
+        // the event may still be signaled from an earlier round, hence the loop
+        while (m_count.load(std::memory_order_acquire) > 0)
+            m_event.wait();
+        while (!isDone()) {
+            if (isSpinWaitUseful())
+                cpuRelax();
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    static const int SPIN_COUNT = 4000;
+
+private:
+    std::atomic<int> m_count { 0 };
+    std::atomic<bool> m_done { true };
+    WaitEvent m_event;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "platform.h"
+
+// Minimal checks for the headless tests. Failures are counted instead of
+// aborting so one run reports all of them, main returns testResult().
+
+inline int &testFailureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++testFailureCount(); \
+        } \
+    } while (0)
+
+inline int testResult()
+{
+    if (testFailureCount())
+        fprintf(stderr, "%d checks failed\n", testFailureCount());
+    else
+        printf("all checks passed\n");
+    return testFailureCount() ? 1 : 0;
+}
+
+#endif
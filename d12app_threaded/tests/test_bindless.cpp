@@ -0,0 +1,50 @@
+#include "bindless.h"
+#include "nullbackend.h"
+#include "test.h"
+
+// The BindlessTable and the DescRing share one shader-visible heap: the table
+// is its reserved front, ring ranges never overlap it.
+
+int main()
+{
+    const UINT RING_SIZE = 64;
+    const UINT TABLE_SIZE = 16;
+    const SIZE_T handleSize = NullBackend::HANDLE_SIZE;
+
+    NullBackend backend;
+    DescRing ring;
+    CHECK(ring.initialize(&backend, RING_SIZE, TABLE_SIZE));
+    BindlessTable table;
+    CHECK(table.initialize(&ring));
+
+    CHECK(table.heap() == ring.heap());
+    CHECK(table.capacity() == TABLE_SIZE);
+    CHECK(table.gpuStart().ptr == ring.gpuStart().ptr);
+    for (UINT i = 0; i < TABLE_SIZE; ++i)
+        CHECK(table.allocate() == i);
+    CHECK(table.allocate() == BindlessTable::INVALID_INDEX);
+
+    const SIZE_T ringStart = ring.cpuStart().ptr + TABLE_SIZE * handleSize;
+    const SIZE_T heapEnd = ring.cpuStart().ptr + (TABLE_SIZE + RING_SIZE) * handleSize;
+    // a few frames worth, so the ring wraps around
+    for (UINT frame = 0; frame < 8; ++frame) {
+        ring.beginFrame(frame % FRAMES_IN_FLIGHT);
+        for (UINT n = 1; n <= 6; ++n) {
+            DescRing::Range range;
+            CHECK(ring.allocate(n, &range));
+            CHECK(range.cpu.ptr >= ringStart);
+            CHECK(range.cpu.ptr + n * handleSize <= heapEnd);
+            CHECK(range.gpu.ptr - ring.gpuStart().ptr == range.cpu.ptr - ring.cpuStart().ptr);
+        }
+    }
+
+    table.releaseResources();
+    ring.releaseResources();
+
+    // without reserved descriptors there is no table
+    CHECK(ring.initialize(&backend, RING_SIZE));
+    CHECK(!table.initialize(&ring));
+    ring.releaseResources();
+
+    return testResult();
+}
@@ -0,0 +1,149 @@
+#include "buddyallocator.h"
+#include "test.h"
+#include <random>
+
+// BuddyAllocator against a model that only tracks which min blocks are in use.
+// With eager coalescing, an order k allocation must succeed exactly when some
+// naturally aligned run of 2^k min blocks is entirely free.
+
+namespace {
+
+struct Model
+{
+    explicit Model(UINT blockCount) : used(blockCount, false) { }
+
+    bool isFree(UINT first, UINT count) const
+    {
+        for (UINT i = first; i < first + count; ++i) {
+            if (used[i])
+                return false;
+        }
+        return true;
+    }
+    bool hasFreeRun(UINT count) const
+    {
+        for (UINT first = 0; first + count <= used.size(); first += count) {
+            if (isFree(first, count))
+                return true;
+        }
+        return false;
+    }
+    UINT largestFreeRun() const
+    {
+        for (UINT count = UINT(used.size()); count; count >>= 1) {
+            if (hasFreeRun(count))
+                return count;
+        }
+        return 0;
+    }
+    void mark(UINT first, UINT count, bool v)
+    {
+        for (UINT i = first; i < first + count; ++i)
+            used[i] = v;
+    }
+
+    std::vector<bool> used;
+};
+
+UINT blocksFor(UINT64 size, UINT64 alignment, UINT64 minBlockSize)
+{
+    UINT64 blocks = ((std::max)((std::max)(size, alignment), minBlockSize) + minBlockSize - 1) / minBlockSize;
+    UINT count = 1;
+    while (count < blocks)
+        count <<= 1;
+    return count;
+}
+
+void testBasics()
+{
+    BuddyAllocator a;
+    CHECK(!a.initialize(1000, 64));
+    CHECK(!a.initialize(1024, 48));
+    CHECK(!a.initialize(64, 128));
+    CHECK(a.initialize(1024, 64));
+    CHECK(a.size() == 1024);
+    CHECK(a.largestFreeBlock() == 1024);
+
+    UINT64 o0, o1, o2;
+    CHECK(a.allocate(64, 1, &o0) && o0 == 0);
+    CHECK(a.allocate(100, 1, &o1) && o1 == 128); // 128 byte block, 64..127 stays free
+    CHECK(a.allocate(1, 256, &o2) && o2 == 256);
+    CHECK(a.used() == 64 + 128 + 256);
+    CHECK(a.largestFreeBlock() == 512);
+    UINT64 big;
+    CHECK(!a.allocate(1024, 1, &big));
+
+    a.release(o1);
+    a.release(o0);
+    CHECK(a.largestFreeBlock() == 512);
+    a.release(o2);
+    // all coalesced again
+    CHECK(a.used() == 0);
+    CHECK(a.largestFreeBlock() == 1024);
+    CHECK(a.allocate(1024, 1, &big) && big == 0);
+    a.release(big);
+}
+
+void fuzz(UINT64 size, UINT64 minBlockSize, int opCount, UINT seed)
+{
+    BuddyAllocator a;
+    CHECK(a.initialize(size, minBlockSize));
+    const UINT blockCount = UINT(size / minBlockSize);
+    Model model(blockCount);
+    std::map<UINT64, UINT> live; // offset -> min blocks
+    UINT64 used = 0;
+
+    std::mt19937 rng(seed);
+    for (int op = 0; op < opCount; ++op) {
+        // bias towards allocating while mostly empty, freeing while mostly full
+        const bool doAlloc = live.empty() || std::uniform_int_distribution<UINT64>(0, size)(rng) >= used;
+        if (doAlloc) {
+            // mostly small, sometimes large, so the heap fragments
+            const UINT maxShift = std::uniform_int_distribution<int>(0, 31)(rng) ? 2 : bitScanReverse64(blockCount);
+            const UINT64 allocSize = std::uniform_int_distribution<UINT64>(1, minBlockSize << maxShift)(rng);
+            const UINT64 alignment = UINT64(1) << std::uniform_int_distribution<int>(0, bitScanReverse64(minBlockSize) + 2)(rng);
+            const UINT count = blocksFor(allocSize, alignment, minBlockSize);
+            const bool expected = count <= blockCount && model.hasFreeRun(count);
+            UINT64 offset = 0;
+            const bool ok = a.allocate(allocSize, alignment, &offset);
+            CHECK(ok == expected);
+            if (!ok)
+                continue;
+            CHECK(offset % alignment == 0);
+            CHECK(offset % (UINT64(count) * minBlockSize) == 0);
+            CHECK(offset + allocSize <= size);
+            const UINT first = UINT(offset / minBlockSize);
+            CHECK(model.isFree(first, count));
+            model.mark(first, count, true);
+            live[offset] = count;
+            used += UINT64(count) * minBlockSize;
+        } else {
+            auto it = live.begin();
+            std::advance(it, std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng));
+            a.release(it->first);
+            model.mark(UINT(it->first / minBlockSize), it->second, false);
+            used -= UINT64(it->second) * minBlockSize;
+            live.erase(it);
+        }
+        CHECK(a.used() == used);
+        CHECK(a.largestFreeBlock() == UINT64(model.largestFreeRun()) * minBlockSize);
+        if (testFailureCount())
+            return;
+    }
+
+    for (const auto &l : live)
+        a.release(l.first);
+    CHECK(a.used() == 0);
+    CHECK(a.largestFreeBlock() == size);
+}
+
+}
+
+int main()
+{
+    testBasics();
+    fuzz(64 * 1024 * 1024, 64 * 1024, 20000, 1);
+    fuzz(4096, 16, 20000, 2);
+    fuzz(1U << 20, 4096, 20000, 3);
+    return testResult();
+}
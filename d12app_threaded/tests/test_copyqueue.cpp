@@ -0,0 +1,126 @@
+#include "app.h"
+#include "nullbackend.h"
+#include "test.h"
+#include "../bench/bench.h"
+
+// Early submit with a copy builder that comes after its consumer in the
+// BuilderTable. The consumer's direct queue list must not be executed before
+// the copy list went out and the direct queue waits for it (or it is done).
+
+namespace {
+
+struct CopyBuilder : Builder
+{
+    CopyBuilder() : Builder(Type::CopyCommandList) { }
+    void processEvent(Event e) override
+    {
+        if (e == Event::Build)
+            benchBusyWork(200000);
+    }
+};
+
+struct DrawBuilder : Builder
+{
+    DrawBuilder() : Builder(Type::GraphicsCommandList) { }
+    void processEvent(Event e) override
+    {
+        if (e == Event::Build)
+            benchBusyWork(1000);
+    }
+};
+
+// Tracks, per copy list, the copy fence value signaled after it, and checks
+// each consumer list against what the direct queue waits for.
+struct CheckingBackend : NullBackend
+{
+    CheckingBackend() : NullBackend(500000) { }
+
+    void executeCopyCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override
+    {
+        for (UINT i = 0; i < count; ++i)
+            unsignaled.push_back(cmdLists[i]);
+        NullBackend::executeCopyCommandLists(count, cmdLists);
+    }
+    void signalCopyFence(UINT64 value) override
+    {
+        for (ID3D12CommandList *cmdList : unsignaled)
+            copyFenceValues[cmdList] = value;
+        unsignaled.clear();
+        NullBackend::signalCopyFence(value);
+    }
+    void queueWaitCopyFence(UINT64 value) override
+    {
+        waitedValue = (std::max)(waitedValue, value);
+        NullBackend::queueWaitCopyFence(value);
+    }
+    void executeCommandLists(UINT count, ID3D12CommandList *const *cmdLists) override
+    {
+        const UINT64 covered = (std::max)(waitedValue, completedCopyFenceValue());
+        for (UINT i = 0; i < count; ++i) {
+            for (const std::pair<Builder *, Builder *> &dep : dependencies) {
+                if (cmdLists[i] != dep.first->commandList(slot))
+                    continue;
+                ++checkedLists;
+                ID3D12CommandList *copyList = dep.second->commandList(slot);
+                auto it = copyFenceValues.find(copyList);
+                CHECK(it != copyFenceValues.end());
+                if (it != copyFenceValues.end()) {
+                    CHECK(it->second <= covered);
+                    copyFenceValues.erase(it);
+                }
+            }
+        }
+        NullBackend::executeCommandLists(count, cmdLists);
+    }
+
+    UINT slot = 0;
+    std::vector<std::pair<Builder *, Builder *>> dependencies; // consumer, copy builder
+    std::vector<ID3D12CommandList *> unsignaled;
+    std::map<ID3D12CommandList *, UINT64> copyFenceValues;
+    UINT64 waitedValue = 0;
+    int checkedLists = 0;
+};
+
+void testCopyAfterConsumer(Builder::ThreadModel threadModel)
+{
+    CheckingBackend *backend = new CheckingBackend;
+    App app(nullptr, nullptr, threadModel, backend);
+    app.setEarlySubmit(true);
+
+    // same stage, copy last
+    DrawBuilder *consumer0 = new DrawBuilder;
+    CopyBuilder *copy0 = new CopyBuilder;
+    consumer0->addDependency(copy0);
+    // explicit dependency on a copy builder in a later stage, which itself
+    // must not fall back to depending on the stage with its consumer
+    DrawBuilder *consumer1 = new DrawBuilder;
+    DrawBuilder *other = new DrawBuilder;
+    CopyBuilder *copy1 = new CopyBuilder;
+    consumer1->addDependency(copy1);
+    copy1->addDependency(copy0);
+    app.addBuilders({ consumer0, copy0, consumer1, other, copy1 });
+    BuilderTable bldTab = { { consumer0, copy0 }, { consumer1, other }, { copy1 } };
+    backend->dependencies = { { consumer0, copy0 }, { consumer1, copy1 } };
+
+    const int frameCount = 20;
+    app.setFrameFunc([&app, backend, &bldTab] {
+        backend->slot = app.m_currentFrameSlot;
+        return &bldTab;
+    });
+    for (int frame = 0; frame < frameCount; ++frame)
+        app.render();
+
+    CHECK(backend->checkedLists == 2 * frameCount);
+    CHECK(backend->stats().executedCopyCommandLists == UINT64(2 * frameCount));
+    app.releaseResources();
+}
+
+}
+
+int main()
+{
+    testCopyAfterConsumer(Builder::ThreadModel::NonThreaded);
+    testCopyAfterConsumer(Builder::ThreadModel::Threaded);
+    testCopyAfterConsumer(Builder::ThreadModel::JobSystem);
+    return testResult();
+}
@@ -0,0 +1,202 @@
+#include "descheapmgr.h"
+#include "nullbackend.h"
+#include "test.h"
+#include <random>
+
+// The freeMap/summary search in DescHeapMgr against a plain first-fit model.
+// Shader-visible ranges are allocated so no thread cache is involved, and
+// released in batches through release(ranges, count) for the same reason.
+
+namespace {
+
+const D3D12_DESCRIPTOR_HEAP_TYPE TYPE = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+const D3D12_DESCRIPTOR_HEAP_FLAGS FLAGS = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+struct Model
+{
+    explicit Model(UINT capacity) : isFree(capacity, true) { }
+
+    bool firstFit(UINT n, UINT *pos) const
+    {
+        UINT run = 0;
+        for (UINT i = 0; i < isFree.size(); ++i) {
+            run = isFree[i] ? run + 1 : 0;
+            if (run == n) {
+                *pos = i + 1 - n;
+                return true;
+            }
+        }
+        return false;
+    }
+    UINT largestFreeRun() const
+    {
+        UINT best = 0;
+        UINT run = 0;
+        for (bool f : isFree) {
+            run = f ? run + 1 : 0;
+            best = (std::max)(best, run);
+        }
+        return best;
+    }
+    void mark(UINT pos, UINT n, bool f)
+    {
+        for (UINT i = pos; i < pos + n; ++i)
+            isFree[i] = f;
+    }
+
+    std::vector<bool> isFree;
+};
+
+struct Live {
+    UINT pos;
+    UINT n;
+};
+
+void checkAgainstModel(UINT capacity, int opCount, UINT seed)
+{
+    NullBackend backend;
+    backend.initialize(nullptr, 1, 1);
+    DescHeapMgr mgr;
+    mgr.initialize(&backend);
+    mgr.setHeapPolicy(TYPE, { capacity, capacity, 1 });
+
+    // the first allocation creates the heap at position 0
+    Model model(capacity);
+    std::vector<Live> live;
+    D3D12_CPU_DESCRIPTOR_HANDLE first = mgr.allocate(TYPE, 1, FLAGS);
+    CHECK(first.ptr);
+    model.mark(0, 1, false);
+    live.push_back({ 0, 1 });
+    const SIZE_T heapStart = first.ptr;
+    const SIZE_T handleSize = NullBackend::HANDLE_SIZE;
+
+    std::mt19937 rng(seed);
+    for (int op = 0; op < opCount; ++op) {
+        const UINT freeCount = UINT(std::count(model.isFree.begin(), model.isFree.end(), true));
+        if (live.empty() || std::uniform_int_distribution<UINT>(0, capacity)(rng) < freeCount) {
+            // mostly small ranges, some spanning several words
+            const UINT n = std::uniform_int_distribution<int>(0, 7)(rng)
+                ? std::uniform_int_distribution<UINT>(1, 16)(rng)
+                : std::uniform_int_distribution<UINT>(17, 300)(rng);
+            UINT expected;
+            if (!model.firstFit(n, &expected))
+                continue; // would create a second heap
+            const D3D12_CPU_DESCRIPTOR_HANDLE h = mgr.allocate(TYPE, n, FLAGS);
+            CHECK(h.ptr);
+            if (!h.ptr)
+                continue;
+            const UINT pos = UINT((h.ptr - heapStart) / handleSize);
+            CHECK(pos == expected);
+            model.mark(pos, n, false);
+            live.push_back({ pos, n });
+        } else {
+            // release a few at once, in random order
+            const int count = std::uniform_int_distribution<int>(1, 4)(rng);
+            std::vector<DescHeapMgr::Range> ranges;
+            for (int i = 0; i < count && !live.empty(); ++i) {
+                const size_t idx = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+                DescHeapMgr::Range r;
+                r.handle.ptr = heapStart + SIZE_T(live[idx].pos) * handleSize;
+                r.n = live[idx].n;
+                ranges.push_back(r);
+                model.mark(live[idx].pos, live[idx].n, true);
+                live[idx] = live.back();
+                live.pop_back();
+            }
+            mgr.release(ranges.data(), ranges.size());
+        }
+
+        const DescHeapMgr::TypeStats s = mgr.stats().types[TYPE];
+        CHECK(s.heapCount == 1);
+        CHECK(s.used == capacity - UINT(std::count(model.isFree.begin(), model.isFree.end(), true)));
+        CHECK(s.largestFreeRun == model.largestFreeRun());
+        if (testFailureCount())
+            return;
+    }
+
+    mgr.releaseResources();
+}
+
+void testEdges()
+{
+    NullBackend backend;
+    backend.initialize(nullptr, 1, 1);
+    DescHeapMgr mgr;
+    mgr.initialize(&backend);
+    // not a multiple of 64, the bits past the end must never be handed out
+    mgr.setHeapPolicy(TYPE, { 130, 130, 1 });
+
+    D3D12_CPU_DESCRIPTOR_HANDLE all = mgr.allocate(TYPE, 130, FLAGS);
+    CHECK(all.ptr);
+    CHECK(mgr.stats().types[TYPE].largestFreeRun == 0);
+    DescHeapMgr::Range r = { all, 130 };
+    mgr.release(&r, 1);
+
+    // a run crossing two word boundaries
+    D3D12_CPU_DESCRIPTOR_HANDLE a = mgr.allocate(TYPE, 60, FLAGS);
+    D3D12_CPU_DESCRIPTOR_HANDLE b = mgr.allocate(TYPE, 70, FLAGS);
+    CHECK(b.ptr == a.ptr + 60 * NullBackend::HANDLE_SIZE);
+    r = { a, 60 };
+    mgr.release(&r, 1);
+    D3D12_CPU_DESCRIPTOR_HANDLE c = mgr.allocate(TYPE, 61, FLAGS);
+    CHECK(mgr.stats().types[TYPE].heapCount == 2); // 61 does not fit in front of b
+    D3D12_CPU_DESCRIPTOR_HANDLE d = mgr.allocate(TYPE, 60, FLAGS);
+    CHECK(d.ptr == a.ptr);
+    DescHeapMgr::Range rest[] = { { b, 70 }, { c, 61 }, { d, 60 } };
+    mgr.release(rest, 3);
+    mgr.releaseResources();
+}
+
+void testSingles()
+{
+    NullBackend backend;
+    backend.initialize(nullptr, 1, 1);
+    DescHeapMgr mgr;
+    mgr.initialize(&backend);
+
+    // shader-visible singles go straight back to their heap
+    D3D12_CPU_DESCRIPTOR_HANDLE v = mgr.allocate(TYPE, 1, FLAGS);
+    CHECK(mgr.stats().types[TYPE].used == 1);
+    mgr.release(v, 1);
+    CHECK(mgr.stats().types[TYPE].used == 0);
+
+    // others take a batch for the thread cache and are returned in batches,
+    // unless leak tracking bypasses the cache
+    const UINT cached = TRACK_DESCRIPTOR_LEAKS ? 1 : DescHeapMgr::CACHE_BATCH;
+    D3D12_CPU_DESCRIPTOR_HANDLE h = mgr.allocate(TYPE, 1);
+    CHECK(mgr.stats().types[TYPE].used == cached);
+    mgr.release(h, 1);
+    CHECK(mgr.stats().types[TYPE].used == (TRACK_DESCRIPTOR_LEAKS ? 0 : cached));
+    mgr.flushThreadCache();
+    CHECK(mgr.stats().types[TYPE].used == 0);
+
+    // a thread exiting without flushing hands its cached slots back
+    DescHeapMgr::Range kept = {};
+    std::thread([&mgr, &kept] {
+        D3D12_CPU_DESCRIPTOR_HANDLE a = mgr.allocate(TYPE, 1);
+        kept = { mgr.allocate(TYPE, 1), 1 };
+        mgr.release(a, 1);
+    }).join();
+    CHECK(mgr.stats().types[TYPE].used == 1);
+    mgr.release(&kept, 1);
+
+    // a shader-visible heap created after the thread cached its view of the heaps
+    D3D12_CPU_DESCRIPTOR_HANDLE big = mgr.allocate(TYPE, 5000, FLAGS);
+    CHECK(mgr.stats().types[TYPE].heapCount == 3);
+    D3D12_CPU_DESCRIPTOR_HANDLE second = big;
+    second.ptr += NullBackend::HANDLE_SIZE;
+    mgr.release(second, 1);
+    CHECK(mgr.stats().types[TYPE].used == 4999);
+    mgr.releaseResources();
+}
+
+}
+
+int main()
+{
+    testEdges();
+    testSingles();
+    checkAgainstModel(4000, 20000, 1);
+    checkAgainstModel(20000, 20000, 2);
+    return testResult();
+}
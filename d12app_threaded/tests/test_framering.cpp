@@ -0,0 +1,58 @@
+#include "framering.h"
+#include "test.h"
+#include <random>
+
+// FrameRing offsets must be aligned even when the capacity is not a multiple
+// of the alignment, and pieces live in the same frames must never overlap.
+
+namespace {
+
+struct Piece
+{
+    UINT64 offset;
+    UINT64 size;
+};
+
+bool overlaps(const Piece &a, const Piece &b)
+{
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+void checkCapacity(UINT64 capacity, std::mt19937 &rng)
+{
+    const int SLOTS = 2;
+    FrameRing ring;
+    ring.reset(capacity);
+    std::vector<Piece> frames[SLOTS];
+    for (int frame = 0; frame < 200; ++frame) {
+        const int slot = frame % SLOTS;
+        // the slot's previous frame is done, the other one may still be in use
+        ring.beginFrame(slot);
+        frames[slot].clear();
+        for (int i = 0; i < 8; ++i) {
+            const UINT64 alignment = UINT64(1) << (rng() % 6);
+            const UINT64 size = 1 + rng() % (capacity / 8);
+            UINT64 offset;
+            if (!ring.allocate(size, alignment, &offset))
+                continue;
+            CHECK(offset % alignment == 0);
+            CHECK(offset + size <= capacity);
+            const Piece piece = { offset, size };
+            for (const std::vector<Piece> &live : frames) {
+                for (const Piece &other : live)
+                    CHECK(!overlaps(piece, other));
+            }
+            frames[slot].push_back(piece);
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(42);
+    for (UINT64 capacity : { 256, 100, 1000, 4099 })
+        checkCapacity(capacity, rng);
+    return testResult();
+}
@@ -0,0 +1,33 @@
+#include "trace.h"
+#include "test.h"
+#include <string>
+
+// Names with quotes, backslashes and control characters must come out as
+// valid JSON strings.
+
+int main()
+{
+    const char *filename = "test_trace.json";
+    Trace::setThreadName("main \"thread\"");
+    const INT64 t = Trace::now();
+    Trace::record("C:\\path \"quoted\"\tname", t, t + 1000);
+    CHECK(Trace::dump(filename));
+
+    std::string json;
+    if (FILE *f = fopen(filename, "rb")) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            json.append(buf, n);
+        fclose(f);
+    }
+    remove(filename);
+
+    // thread names are only kept with tracing on, events are written either way
+    if (ENABLE_TRACE)
+        CHECK(json.find("\"main \\\"thread\\\"\"") != std::string::npos);
+    CHECK(json.find("\"C:\\\\path \\\"quoted\\\"\\u0009name\"") != std::string::npos);
+    CHECK(json.find('\t') == std::string::npos);
+
+    return testResult();
+}
@@ -1,7 +1,7 @@
 #ifndef TIMESTAMP_H
 #define TIMESTAMP_H
 
-#include "common.h"
+#include "platform.h"
 
 struct Timestamp
 {
@@ -0,0 +1,120 @@
+#include "trace.h"
+
+namespace Trace {
+
+static const UINT EVENTS_PER_THREAD = 4096; // must be a power of two
+
+struct Event
+{
+    const char *name;
+    INT64 start;
+    INT64 duration;
+};
+
+struct ThreadBuffer
+{
+    UINT32 threadId;
+    char name[64];
+    std::atomic<UINT64> writePos { 0 };
+    Event events[EVENTS_PER_THREAD];
+};
+
+static std::mutex s_buffersMutex;
+static std::vector<ThreadBuffer *> s_buffers; // never freed so that events survive their thread
+static thread_local ThreadBuffer *t_buffer = nullptr;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+static ThreadBuffer *threadBuffer()
+{
+    if (!t_buffer) {
+        t_buffer = new ThreadBuffer;
+        t_buffer->threadId = currentThreadId();
+        t_buffer->name[0] = '\0';
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        s_buffers.push_back(t_buffer);
+    }
+    return t_buffer;
+}
+
+INT64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void record(const char *name, INT64 startNs, INT64 endNs)
+{
+    ThreadBuffer *buf = threadBuffer();
+    const UINT64 pos = buf->writePos.load(std::memory_order_relaxed);
+    Event &e(buf->events[pos & (EVENTS_PER_THREAD - 1)]);
+    e.name = name;
+    e.start = startNs;
+    e.duration = endNs - startNs;
+    buf->writePos.store(pos + 1, std::memory_order_release);
+}
+
+void setThreadName(const char *name)
+{
+    if (!ENABLE_TRACE)
+        return;
+    ThreadBuffer *buf = threadBuffer();
+    snprintf(buf->name, sizeof(buf->name), "%s", name);
+}
+
+// names are arbitrary C strings, the JSON must stay valid whatever they contain
+static void writeJsonString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; ++s) {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+bool dump(const char *filename)
+{
+    if (!ENABLE_TRACE)
+        log("Trace events are only recorded with ENABLE_TRACE set");
+    FILE *f = openFileForWriting(filename);
+    if (!f) {
+        log("Failed to open %s for writing", filename);
+        return false;
+    }
+
+    size_t eventCount = 0;
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+    std::lock_guard<std::mutex> lock(s_buffersMutex);
+    for (ThreadBuffer *buf : s_buffers) {
+        if (buf->name[0]) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", buf->threadId);
+            writeJsonString(f, buf->name);
+            fprintf(f, "}}");
+            first = false;
+        }
+        const UINT64 end = buf->writePos.load(std::memory_order_acquire);
+        const UINT64 begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+        for (UINT64 pos = begin; pos < end; ++pos) {
+            const Event &e(buf->events[pos & (EVENTS_PER_THREAD - 1)]);
+            fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+            writeJsonString(f, e.name);
+            fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                buf->threadId, e.start / 1000.0, e.duration / 1000.0);
+            first = false;
+            ++eventCount;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    log("Wrote %zu trace events from %zu threads to %s", eventCount, s_buffers.size(), filename);
+    return true;
+}
+
+} // namespace
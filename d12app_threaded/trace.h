@@ -0,0 +1,26 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+
+// Low-overhead timeline tracing. Each thread records complete (begin + duration)
+// events into its own ring buffer, dump() writes them out as Chrome trace JSON
+// that chrome://tracing and Perfetto can load. Dump while the builders are idle.
+namespace Trace {
+
+INT64 now();
+void record(const char *name, INT64 startNs, INT64 endNs);
+void setThreadName(const char *name);
+bool dump(const char *filename);
+
+struct Scope
+{
+    Scope(const char *name) : m_name(name), m_start(ENABLE_TRACE ? now() : 0) { }
+    ~Scope() { if (ENABLE_TRACE) record(m_name, m_start, now()); }
+    const char *m_name;
+    INT64 m_start;
+};
+
+} // namespace
+
+#endif
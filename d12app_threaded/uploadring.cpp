@@ -0,0 +1,71 @@
+#include "uploadring.h"
+#include "res.h"
+
+bool UploadRing::initialize(ID3D12Device *dev, UINT64 capacity)
+{
+    m_buffer = Res::createBuffer(dev, Res::Storage::HostToDevice, capacity);
+    if (!m_buffer)
+        return false;
+
+    const D3D12_RANGE noRead = {};
+    void *p = nullptr;
+    HRESULT hr = m_buffer->Map(0, &noRead, &p);
+    if (FAILED(hr)) {
+        logHr("Failed to map upload ring buffer", hr);
+        Res::releaseResource(m_buffer);
+        m_buffer = nullptr;
+        return false;
+    }
+
+    m_cpuStart = static_cast<char *>(p);
+    m_gpuStart = m_buffer->GetGPUVirtualAddress();
+    m_ring.reset(capacity);
+    return true;
+}
+
+void UploadRing::releaseResources()
+{
+    if (m_buffer) {
+        m_buffer->Unmap(0, nullptr);
+        Res::releaseResource(m_buffer);
+        m_buffer = nullptr;
+    }
+    m_cpuStart = nullptr;
+    m_gpuStart = 0;
+    m_ring.reset(0);
+}
+
+bool UploadRing::allocate(UINT64 size, UINT64 alignment, Allocation *allocation)
+{
+    if (!m_buffer)
+        return false;
+
+    UINT64 offset;
+    if (!m_ring.allocate(size, alignment, &offset)) {
+        log("Upload ring is full (%llu used, %llu requested)", m_ring.used(), size);
+        return false;
+    }
+    allocation->cpu = m_cpuStart + offset;
+    allocation->buffer = m_buffer;
+    allocation->offset = offset;
+    allocation->gpu = m_gpuStart + offset;
+    return true;
+}
+
+bool UploadRing::upload(const void *data, UINT64 size, UINT64 alignment, Allocation *allocation)
+{
+    if (!allocate(size, alignment, allocation))
+        return false;
+    memcpy(allocation->cpu, data, size_t(size));
+    return true;
+}
+
+bool UploadRing::uploadToBuffer(ID3D12GraphicsCommandList *cmdList, ID3D12Resource *dst, UINT64 dstOffset, const void *data, UINT64 size)
+{
+    Allocation allocation;
+    // buffer to buffer copies have no alignment requirement, 16 keeps the memcpy fast
+    if (!upload(data, size, 16, &allocation))
+        return false;
+    cmdList->CopyBufferRegion(dst, dstOffset, allocation.buffer, allocation.offset, size);
+    return true;
+}
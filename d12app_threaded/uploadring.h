@@ -0,0 +1,45 @@
+#ifndef UPLOADRING_H
+#define UPLOADRING_H
+
+#include "common.h"
+#include "framering.h"
+
+// One large upload heap buffer, mapped for its whole lifetime, that per-frame
+// data is suballocated from. Like the DescRing, the App reclaims a slot's
+// allocations in beginFrame once its fence has passed, so nothing is freed
+// individually and the data must not be needed after the frame. The buffer is
+// committed, as a placed resource it would take a ResHeapAllocator heap of its
+// own.
+struct UploadRing
+{
+    struct Allocation {
+        void *cpu;
+        ID3D12Resource *buffer;
+        UINT64 offset; // in buffer
+        D3D12_GPU_VIRTUAL_ADDRESS gpu;
+    };
+
+    bool initialize(ID3D12Device *dev, UINT64 capacity);
+    void releaseResources();
+    bool isInitialized() const { return m_buffer != nullptr; }
+
+    // All thread-safe. alignment is a power of two, f.ex.
+    // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT for constant buffers.
+    bool allocate(UINT64 size, UINT64 alignment, Allocation *allocation);
+    bool upload(const void *data, UINT64 size, UINT64 alignment, Allocation *allocation);
+    // Uploads the data and records a copy of it to dst, which must be in the
+    // COPY_DEST state, on cmdList.
+    bool uploadToBuffer(ID3D12GraphicsCommandList *cmdList, ID3D12Resource *dst, UINT64 dstOffset, const void *data, UINT64 size);
+
+    void beginFrame(UINT frameSlot) { m_ring.beginFrame(frameSlot); }
+
+    UINT64 capacity() const { return m_ring.capacity(); }
+    UINT64 used() const { return m_ring.used(); }
+
+    ID3D12Resource *m_buffer = nullptr;
+    char *m_cpuStart = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_gpuStart = 0;
+    FrameRing m_ring;
+};
+
+#endif